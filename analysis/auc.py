@@ -15,8 +15,19 @@ from sklearn.metrics import roc_curve, auc
 save_path = '../result/'
 save_graph_path = './figure/'
 
+# Kind of a result record (7th field): a score, a flow passed as usual by the first stage (no distance),
+# or a low-rate bucket shared by several prefixes (the address field is the bucket index)
+RECORD_SCORE = 0
+RECORD_GATED = 1
+RECORD_MIXED = 2
 
-def f_action(label, loss):
+
+def covers(address: int, prefix_len: int, int_addr: List[int]) -> bool:
+    mask = (0xffffffff << (32 - prefix_len)) & 0xffffffff
+    return any((a & mask) == (address & mask) for a in int_addr)
+
+
+def f_action(name, label, loss):
     from sklearn.metrics import f1_score, fbeta_score, precision_recall_curve
     res = [1 if sc > 6 else 0 for sc in loss]
 
@@ -33,9 +44,9 @@ def f_action(label, loss):
     plt.ylim([0.0, 1.05])
     plt.xlabel('Precision')
     plt.ylabel('Recall')
-    plt.title(f'{args.target} RoC')
+    plt.title(f'{name} RoC')
     plt.legend(loc="lower right")
-    plt.savefig('./figure/' + args.target + '_PRC.png')
+    plt.savefig(save_graph_path + name + '_PRC.png')
 
     # print(f'F1-score={f1:7.6f}')
     # print(f'F2-score={f2:7.6f}')
@@ -43,29 +54,74 @@ def f_action(label, loss):
     print(f'{f1:7.6f}, {f2:7.6f}, {pr_auc:7.6f}')
 
 
-def analyze_action(tag: str, malicious_addr: List[str]) -> None:
+def analyze_action(tag: str, malicious_addr: List[str], victim_addr: List[str]) -> None:
 
     int_malicious_addr = []
+    int_victim_addr = []
     traget_files = os.listdir(save_path + '/' + tag)
 
-    normal = []
-    abnormal = []
+    # scores of each view (6th field) and FFT size (5th field), every resolution of a view has its own
+    # models and ROC. The destination view is labeled by the victims, not by the attackers.
+    normal = {}
+    abnormal = {}
+    gated_pkt_num = 0
+    mixed_pkt_num = 0
+    # prefix aggregates (4th field below 32) are not hosts, they are counted apart
+    aggregate_pkt_num = 0
+    aggregate_abnormal_pkt_num = 0
 
     for addr in malicious_addr:
         int_malicious_addr.append(struct.unpack('!I', socket.inet_aton(addr))[0])
+    for addr in victim_addr:
+        int_victim_addr.append(struct.unpack('!I', socket.inet_aton(addr))[0])
 
     print('Read files from: ' + save_path + tag)
     for file in traget_files:
         with open(save_path + tag + '/' + file, 'r') as f:
             ls = json.load(f)['Results']
             for entery in ls:
-                if entery[0] in int_malicious_addr:
-                    abnormal.extend([*(entery[1] for _ in range(entery[2]))])
+                if len(entery) > 6 and entery[6] == RECORD_GATED:
+                    gated_pkt_num += entery[2]
+                    continue
+                if len(entery) > 6 and entery[6] == RECORD_MIXED:
+                    mixed_pkt_num += entery[2]
+                    continue
+                if len(entery) > 3 and entery[3] < 32:
+                    aggregate_pkt_num += entery[2]
+                    if covers(entery[0], entery[3], int_malicious_addr):
+                        aggregate_abnormal_pkt_num += entery[2]
+                    continue
+                is_destination = len(entery) > 5 and bool(entery[5])
+                key = (is_destination, entery[4] if len(entery) > 4 else 0)
+                normal.setdefault(key, [])
+                abnormal.setdefault(key, [])
+                if entery[0] in (int_victim_addr if is_destination else int_malicious_addr):
+                    abnormal[key].extend([*(entery[1] for _ in range(entery[2]))])
                 else:
-                    normal.extend([*(entery[1] for _ in range(entery[2]))])
-
-    print(f'Normal packets: {len(normal)}, Abnormal packets: {len(abnormal)}.')
-
+                    normal[key].extend([*(entery[1] for _ in range(entery[2]))])
+
+    print(f'Gated packets: {gated_pkt_num}, Mixed low-rate packets: {mixed_pkt_num}.')
+    print(f'Prefix aggregate packets: {aggregate_pkt_num} ({aggregate_abnormal_pkt_num} covering abnormal hosts).')
+
+    n_source_res = sum(1 for is_destination, _ in normal if not is_destination)
+    for key in sorted(normal):
+        is_destination, n_fft = key
+        # the figures of a single source resolution keep the name of the target
+        name = tag if not is_destination and n_source_res == 1 else \
+            f'{tag}_{"dst" if is_destination else "src"}_{n_fft}'
+        view = f'[{"destination" if is_destination else "source"}, n_fft {n_fft}]'
+        print(f'{view} Normal packets: {len(normal[key])}, Abnormal packets: {len(abnormal[key])}.')
+        if is_destination and len(int_victim_addr) == 0:
+            print(f'{view} No victim address of {tag}, no ROC.')
+            continue
+        if len(normal[key]) == 0 or len(abnormal[key]) == 0:
+            print(f'{view} One class only, no ROC.')
+            continue
+        print(f'{view} ', end='')
+        roc_action(name, normal[key], abnormal[key])
+
+
+def roc_action(name: str, normal: List[float], abnormal: List[float]) -> None:
 
     fpr, tpr, _ = roc_curve([*(0 for _ in range(len(normal))), 
                              *(1 for _ in range(len(abnormal)))], 
@@ -81,9 +137,9 @@ def analyze_action(tag: str, malicious_addr: List[str]) -> None:
     plt.ylim([0.0, 1.05])
     plt.xlabel('False Positive Rate')
     plt.ylabel('True Positive Rate')
-    plt.title(f'{tag} RoC')
+    plt.title(f'{name} RoC')
     plt.legend(loc="lower right")
-    plt.savefig(save_graph_path + tag + '.png')
+    plt.savefig(save_graph_path + name + '.png')
 
     deta = 1
     deta_fpr = 1
@@ -108,12 +164,12 @@ def analyze_action(tag: str, malicious_addr: List[str]) -> None:
             deta_tpr = d
             r_fpr = a
 
-    # print(f'[{tag}]')
+    # print(f'[{name}]')
     # print(f'TPR={r_tpr:7.6f} (FPR=0.1)\nFPR={r_fpr:7.6f} (TPR=0.9)')
     # print(f'AUC={roc_auc:7.6f}\nEER={err:7.6f}')
 
     print(f'{roc_auc:7.6f}, {err:7.6f}, ', end='')
-    f_action([*(0 for _ in range(len(normal))), *(1 for _ in range(len(abnormal)))], [*normal, *abnormal])
+    f_action(name, [*(0 for _ in range(len(normal))), *(1 for _ in range(len(abnormal)))], [*normal, *abnormal])
 
     # print(r_tpr, r_fpr, roc_auc, err)
 
@@ -121,19 +177,26 @@ def analyze_action(tag: str, malicious_addr: List[str]) -> None:
 if __name__ == '__main__':
     parser = argparse.ArgumentParser(description='Process some integers.')
     parser.add_argument('-t', '--target', type=str, default='ALL', help='target for analysis')
+    parser.add_argument('-v', '--victim', type=str, default='', 
+                        help='json of the victim addresses of each target, labels of the destination view')
                     
     args = parser.parse_args()
 
     if not os.path.isdir(save_graph_path):
         os.mkdir(save_graph_path)
 
+    victim = {}
+    if args.victim != '':
+        with open(args.victim) as f:
+            victim = json.load(f)
+
     with open('./address.json') as f:
         j = json.load(f)
         tag = args.target
         if tag == 'ALL':
             for tag, addr in j.items():
                 if not str.isdigit(tag):
-                    analyze_action(tag, addr)
+                    analyze_action(tag, addr, victim.get(tag, []))
 
         else:
             if tag in j:
@@ -142,5 +205,5 @@ if __name__ == '__main__':
                 print("Target Not found.")
                 exit(1)
 
-            analyze_action(tag, malicious_addr)
+            analyze_action(tag, malicious_addr, victim.get(tag, []))
 
@@ -16,6 +16,14 @@ void AnalyzerWorkerThread::stop()
 {
     LOGF("Analyzer on core # %2d stop.", getCoreId());
     m_stop = true;
+    // do not wait for the timeout
+    signal_wakeup();
+    // the results of a pipeline stage are recorded by the analyzers owning the flows
+    if (role != ROLE_FULL) {
+        LOGF("Analyzer on core # %2d: %s stage, %ld items.", getCoreId(), 
+             role == ROLE_SPECTRAL ? "spectral" : "scoring", pipeline_item_num);
+        return;
+    }
     sum_analysis_pkt_num += analysis_pkt_num;
     sum_analysis_pkt_len += analysis_pkt_len;
 
@@ -30,6 +38,16 @@ void AnalyzerWorkerThread::stop()
         (sum_analysis_pkt_num /  (analysis_end_time - analysis_start_time)) / 1e6,
         ((sum_analysis_pkt_len * 8.0) /  (analysis_end_time - analysis_start_time)) / 1e9);
     }
+    // the cost and the fidelity of the analysis profile over the run, the analysis time excludes
+    // the idle waits and the reference analysis of the drift samples
+    if (!m_is_train) {
+        const double_t analysis_time = sum_batch_time - profile_drift_time;
+        LOGF("Analyzer on core # %2d: %s profile [%4.3lf Mpps in analysis time, %4.2lfs analysis time, score drift against accurate: mean %6.3lf, max %6.3lf (%ld flows)]",
+             getCoreId(), p_analyzer_config->analysis_profile.c_str(), 
+             analysis_time > 0 ? sum_analysis_pkt_num / analysis_time / 1e6 : 0.0, analysis_time,
+             run_profile_drift_num != 0 ? run_sum_profile_drift / run_profile_drift_num : 0.0, 
+             run_max_profile_drift, run_profile_drift_num);
+    }
 }
 
 
@@ -40,29 +58,61 @@ bool AnalyzerWorkerThread::run(uint32_t coreId)
         WARN("None analyzer config found.");
         return false;
     }
-    if (p_learner == nullptr) {
-        WARN("None learner thread bind.");
+    const auto & view_list = analysis_view_map.at(p_analyzer_config->analysis_view);
+    if (p_learner_vec.size() != view_list.size() * p_analyzer_config->n_fft_list.size() || 
+        find(p_learner_vec.cbegin(), p_learner_vec.cend(), nullptr) != p_learner_vec.cend()) {
+        WARN("None learner thread bind for each FFT size of each view.");
         return false;
     }
-    if (p_parser.size() == 0) {
-        WARN("None parser thread bind.");
+    if (p_lane.size() == 0 && role == ROLE_FULL) {
+        WARN("None parser lane bind.");
         return false;
     }
 
-    meta_pkt_arr = shared_ptr<PacketMetaData[]>(new PacketMetaData[meta_pkt_arr_size](), 
-													std::default_delete<PacketMetaData[]>());
+    // on the hugepages of the node of this core, a pipeline stage receives windows, not packets
+    local_memory_t meta_memory, record_memory;
+    meta_pkt_arr = make_local_array<PacketMetaData>(role == ROLE_FULL ? meta_pkt_arr_size : 1, 
+                                                    "analyzer_meta", &meta_memory);
     if (meta_pkt_arr == nullptr) {
         WARN("Meta packet array: bad allowcation");
         return false;
     }
+    if (p_lane.size() > 1) {
+        merge_pkt_arr = make_local_array<PacketMetaData>(meta_pkt_arr_size, "analyzer_merge");
+        if (merge_pkt_arr == nullptr) {
+            WARN("Merge packet array: bad allowcation");
+            return false;
+        }
+        p_merge_tree = make_shared<LoserTree<double_t> >(p_lane.size());
+        fetch_bound.reserve(p_lane.size() + 1);
+        merge_head.resize(p_lane.size());
+    }
 
-    flow_records = shared_ptr<FlowRecord[]>(new FlowRecord[result_buffer_size](), 
-											std::default_delete<FlowRecord[]>());
+    flow_records = make_local_array<FlowRecord>(result_buffer_size, "analyzer_record", &record_memory);
 
     if (flow_records == nullptr) {
         WARN("Result buffer: bad allowcation");
         return false;
     }
+    const int core_node = (int) rte_socket_id();
+    const int meta_node = local_page_node(meta_pkt_arr.get());
+    if (p_analyzer_config->init_verbose) {
+        LOGF("Analyzer on core # %2d: packet buffer on %s of node %d, result buffer on %s of node %d (core on node %d).", 
+             coreId, local_memory_name[meta_memory], meta_node, local_memory_name[record_memory], 
+             local_page_node(flow_records.get()), core_node);
+    }
+    if (meta_node >= 0 && meta_node != core_node) {
+        WARNF("Analyzer on core # %2d: packet buffer on node %d, remote to the core on node %d.", 
+              coreId, meta_node, core_node);
+    }
+
+    p_kernel = select_spectral_kernel(p_analyzer_config->kernel_isa);
+    if (p_analyzer_config->init_verbose) {
+        LOGF("Analyzer on core # %2d: use %s analysis kernels.", coreId, p_kernel->isa_name);
+    }
+
+    // allocated on the analyzer core, so that the pages are local
+    p_arena = make_shared<BatchArena>(arena_size);
 
     if (p_analyzer_config->init_verbose) {
         LOGF("Analyzer on core # %2d start.", coreId);
@@ -71,27 +121,210 @@ bool AnalyzerWorkerThread::run(uint32_t coreId)
     m_core_id = coreId;
     m_stop = false;
 
-    centers = torch::zeros({(long) p_learner->get_K(), (long) (p_analyzer_config->n_fft / 2) + 1});
+    // the window type is shared by all resolutions
+    if (p_analyzer_config->stft_window == "hann") {
+        sdft_window_a0 = 0.5;
+        sdft_window_a1 = 0.25;
+    } else if (p_analyzer_config->stft_window == "hamming") {
+        sdft_window_a0 = 0.54;
+        sdft_window_a1 = 0.23;
+    } else {
+        sdft_window_a0 = 1;
+        sdft_window_a1 = 0;
+    }
+
+    resolutions.clear();
+    for (size_t r = 0; r < p_analyzer_config->n_fft_list.size(); r ++) {
+        Resolution res;
+        res.n_fft = p_analyzer_config->n_fft_list[r];
+        res.n_freq = res.n_fft / 2 + 1;
+        // the explicit hop belongs to the primary resolution, the others follow the analysis profile
+        res.stft_hop = r == 0 ? p_analyzer_config->stft_hop : 
+                       max(res.n_fft / analysis_profile_map.at(p_analyzer_config->analysis_profile), (size_t) 1);
+        res.reference_hop = res.n_fft / analysis_profile_map.at("accurate");
+        res.shed_hop = max(res.stft_hop, res.n_fft / analysis_profile_map.at("fast"));
+        if (p_analyzer_config->stft_window == "hann") {
+            res.stft_window = torch::hann_window(res.n_fft);
+        } else if (p_analyzer_config->stft_window == "hamming") {
+            res.stft_window = torch::hamming_window(res.n_fft);
+        } else {
+            // undefined tensor for the rectangular window
+            res.stft_window = torch::Tensor();
+        }
+        res.sdft_twiddle = SlidingDft::make_twiddle(res.n_fft);
+        resolutions.push_back(res);
+    }
+
+    // each view groups the same batch by its own address, with its own flows and models
+    const size_t res_num = resolutions.size();
+    views.clear();
+    for (size_t v = 0; v < view_list.size(); v ++) {
+        FlowView view;
+        view.is_destination = view_list[v];
+        view.p_flow_table = make_shared<FlowTable>(p_analyzer_config->max_flow_num, 
+                                                   p_analyzer_config->max_flow_mem, res_num);
+        // the /8 folds (at most 256) are always admitted beyond the prefix budget
+        view.p_aggregate_table = make_shared<FlowTable>(p_analyzer_config->max_aggregate_num + 256, 0, res_num);
+        if (p_analyzer_config->low_rate_bucket_num != 0) {
+            view.p_low_rate_sketch = make_shared<LowRateSketch>(p_analyzer_config->low_rate_bucket_num, 
+                                                                2 * p_analyzer_config->n_fft);
+        }
+        if (p_analyzer_config->cascade_gate) {
+            view.p_cascade = make_shared<CascadeModel>();
+        }
+        for (size_t r = 0; r < res_num; r ++) {
+            ClusterModel model;
+            model.p_learner = p_learner_vec[v * res_num + r];
+            model.centers = torch::zeros({(long) model.p_learner->get_K(), (long) resolutions[r].n_freq});
+            model.center_norms = torch::zeros({(long) model.p_learner->get_K()});
+            model.is_train = true;
+            view.models.push_back(model);
+        }
+        views.push_back(view);
+    }
+    if (p_analyzer_config->heavy_hitter_k != 0) {
+        // more counters than reported, for the accuracy of the top-K
+        p_heavy_hitter = make_shared<SpaceSaving<uint32_t> >(4 * p_analyzer_config->heavy_hitter_k);
+    }
+    p_epoch_wheel = make_shared<HierarchicalTimerWheel<uint64_t> >();
+    analysis_clock = 0;
+
+    if (role != ROLE_FULL) {
+        run_stage();
+        return true;
+    }
+
+    // the parsers wake this analyzer when their buffers fill
+    if (p_analyzer_config->wait_mode == "event" && wakeup_fd < 0) {
+        wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeup_fd < 0) {
+            WARNF("Analyzer on core # %2d: eventfd unavailable, fall back to sleep.", coreId);
+        }
+        for (const auto & _p : p_lane) {
+            _p->wakeup_fd = wakeup_fd;
+        }
+    }
 
     analysis_pkt_num = 0;
     analysis_pkt_len = 0;
     double_t __s = __get_double_ts();
+    wait_time = pause_time;
+    double_t last_start = __s;
 
 
     while(!m_stop) {
 
         // pause and wait data from ParserWorkers
-        usleep(pause_time);
+        wait_for_parser();
 
         // for performance statistic
         double_t __t = __get_double_ts();
         double_t __deta = (__t - __s);
         if (__deta > p_analyzer_config->verbose_interval) {
             if (p_analyzer_config->speed_verbose && ! m_is_train) {
-                LOGF("Analyzer on core # %2d: [ %4.2lf Mpps / %4.2lf Gbps ]", 
+                LOGF("Analyzer on core # %2d: [ %4.2lf Mpps / %4.2lf Gbps ] (%s profile)", 
                 getCoreId(),
                 (((double_t) analysis_pkt_num) / __deta) / 1e6,
-                (((double_t) analysis_pkt_len) * 8.0) / __deta / 1e9);
+                (((double_t) analysis_pkt_len) * 8.0) / __deta / 1e9,
+                p_analyzer_config->analysis_profile.c_str());
+                if (p_analyzer_config->wait_mode == "event") {
+                    LOGF("Analyzer on core # %2d: wakeups [%ld by parsers, %ld by timeout]", 
+                    getCoreId(), wakeup_event_num, wakeup_timeout_num);
+                }
+            }
+            wakeup_event_num = 0;
+            wakeup_timeout_num = 0;
+            if (p_analyzer_config->speed_verbose && p_analyzer_config->work_steal) {
+                const auto & _sc = steal_counter;
+                LOGF("Analyzer on core # %2d: work stealing [%ld own tasks, %ld stolen by others, %ld stolen from others, utilization %4.1lf%%]",
+                getCoreId(), _sc.task_num, _sc.stolen_num.load(), _sc.steal_num, 100.0 * _sc.busy_time / __deta);
+            }
+            steal_counter.busy_time = 0;
+            if (p_analyzer_config->speed_verbose && p_merge_tree != nullptr) {
+                LOGF("Analyzer on core # %2d: merge of %ld parser streams moved %ld packets into time order",
+                getCoreId(), p_merge_tree->size(), reorder_pkt_num);
+            }
+            sum_reorder_pkt_num += reorder_pkt_num;
+            reorder_pkt_num = 0;
+            if (p_analyzer_config->speed_verbose && !out_rings.empty()) {
+                size_t high_water = 0;
+                for (const auto & p_ring : out_rings) {
+                    high_water = max(high_water, p_ring->max_size());
+                }
+                LOGF("Analyzer on core # %2d: pipeline [%ld windows analyzed in place, spectral rings high water %ld / %ld]",
+                getCoreId(), pipeline_inline_num, high_water, out_rings[0]->capacity());
+            }
+            if (p_analyzer_config->speed_verbose && p_analyzer_config->latency_target > 0) {
+                const auto & _bc = batch_ctrl;
+                LOGF("Analyzer on core # %2d: batching [fetch %ld / parser, wait %ld us, %4.1lf ns / packet, %4.3lf Mpps in, %ld of %ld batches over target, max %4.1lf ms]",
+                getCoreId(), max_fetch, wait_time, _bc.pkt_cost * 1e9, _bc.arrival_rate / 1e6, 
+                _bc.over_target_num, _bc.batch_num, _bc.max_batch_time * 1e3);
+            }
+            if (p_analyzer_config->speed_verbose && p_analyzer_config->load_shedding && ! m_is_train) {
+                const auto & _sc = shed_ctrl;
+                LOGF("Analyzer on core # %2d: load shedding [level %d (%s), backlog %4.1lf%%, batch %4.1lf ms, %ld packets sampled out, %ld of skipped flows, %ld per prefix]",
+                getCoreId(), (int) shed_level.load(), shed_level_name[shed_level.load()], 100.0 * _sc.backlog, 
+                _sc.batch_time * 1e3, _sc.sample_pkt_num, _sc.skip_pkt_num, _sc.prefix_pkt_num);
+            }
+            if (profile_drift_num != 0) {
+                LOGF("Analyzer on core # %2d: score drift of %s profile against accurate: [mean %6.3lf, max %6.3lf] (%ld flows)", 
+                getCoreId(), p_analyzer_config->analysis_profile.c_str(),
+                sum_profile_drift / profile_drift_num, max_profile_drift, profile_drift_num);
+                sum_profile_drift = 0;
+                max_profile_drift = 0;
+                profile_drift_num = 0;
+            }
+            if (p_analyzer_config->flow_verbose) {
+                for (const auto & view : views) {
+                    const auto p_table = view.p_flow_table;
+                    const auto & _st = p_table->stat;
+                    const char * view_name = view.is_destination ? "destination" : "source";
+                    LOGF("Analyzer on core # %2d: %s flow table [%ld flows / %ld bytes, high water %ld flows / %ld bytes, evicted idle %ld / flow cap %ld / memory cap %ld, finalized %ld]",
+                    getCoreId(), view_name, p_table->size(), p_table->memory_size(), _st.max_flow_num, _st.max_mem_size,
+                    _st.evict_idle_num, _st.evict_flow_cap_num, _st.evict_mem_cap_num, _st.finalize_num);
+                    if (view.p_low_rate_sketch != nullptr) {
+                        const auto p_sketch = view.p_low_rate_sketch;
+                        LOGF("Analyzer on core # %2d: %s low-rate sketch [%ld buckets / %ld bytes, %ld flows folded, %ld series analyzed]",
+                        getCoreId(), view_name, p_sketch->bucket_num(), p_sketch->memory_size(),
+                        p_sketch->fold_num, p_sketch->series_num);
+                    }
+                }
+                if (p_heavy_hitter != nullptr) {
+                    stringstream ss;
+                    for (size_t i = 0; i < min(heavy_hitter_list.size(), (size_t) 5); i ++) {
+                        ss << pcpp::IPv4Address(htonl(heavy_hitter_list[i].key)).toString() << 
+                              ": " << heavy_hitter_list[i].count << ", ";
+                    }
+                    LOGF("Analyzer on core # %2d: heavy hitters [%ld addresses, top: %s%ld packets skipped]",
+                    getCoreId(), heavy_keys.size(), ss.str().c_str(), heavy_hitter_skip_pkt_num);
+                }
+            }
+
+            if (p_analyzer_config->cascade_gate && cascade_counter.decision_num != 0) {
+                const auto & _cs = cascade_counter;
+                // throughput gain against all packets through the frequency domain path
+                const double_t fft_cost = _cs.fft_pkt_num == 0 ? 0 : _cs.fft_time / _cs.fft_pkt_num;
+                const double_t gain = fft_cost * (_cs.fft_pkt_num + _cs.gate_pkt_num) / 
+                                      max(_cs.stage_time + _cs.fft_time, 1e-9);
+                LOGF("Analyzer on core # %2d: first stage gated %4.2lf%% of %ld decisions (%4.2lf%% of packets), est. throughput gain x%4.2lf",
+                getCoreId(), 100.0 * _cs.gate_num / _cs.decision_num, _cs.decision_num,
+                100.0 * _cs.gate_pkt_num / max(_cs.fft_pkt_num + _cs.gate_pkt_num, (size_t) 1), gain);
+                sum_cascade_gate_pkt_num += _cs.gate_pkt_num;
+                sum_cascade_fft_pkt_num += _cs.fft_pkt_num;
+                cascade_counter = CascadeCounter();
+            }
+
+            if (overflow_pkt_num != 0) {
+                size_t aggregate_num = 0;
+                for (const auto & view : views) {
+                    aggregate_num += view.p_aggregate_table->size();
+                }
+                WARNF("Analyzer on core # %2d: address flood, %ld packets of new addresses beyond the flow table, aggregated into %ld prefixes (%ld packets folded to /8).",
+                getCoreId(), overflow_pkt_num, aggregate_num, fold_pkt_num);
+                sum_overflow_pkt_num += overflow_pkt_num;
+                sum_fold_pkt_num += fold_pkt_num;
+                overflow_pkt_num = 0;
+                fold_pkt_num = 0;
             }
 
             if (! m_is_train) {
@@ -121,15 +354,29 @@ bool AnalyzerWorkerThread::run(uint32_t coreId)
                 sum_aggregate_time = 0;
             }
 #endif
+#ifdef SPECTRAL_KERNEL_BENCH
+            if (true) {
+                LOGF("Analyzer on core # %2d: [Fused kernel: %4.2lf, Legacy chain: %4.2lf, Speedup: %4.2lfx, Max fused kernel error: %.3e].",
+                getCoreId(), sum_fused_kernel_time, sum_legacy_transform_time, 
+                sum_legacy_transform_time / max(sum_fused_kernel_time, 1e-9), max_fused_kernel_error);
+                sum_fused_kernel_time = 0;
+                sum_legacy_transform_time = 0;
+            }
+#endif
 
         }
 
         // fetch pper-packets properties form ParserWorkers
+        const double_t backlog_share = p_analyzer_config->load_shedding ? lane_backlog() : 0;
         size_t sum_fetch = 0;
-        for (const auto _p : p_parser) {
-            _p->acquire_semaphore();
+        fetch_bound.clear();
+        for (const auto _p : p_lane) {
+            fetch_bound.push_back(m_index);
             sum_fetch += fetch_form_parser(_p);
-            _p->release_semaphore();
+        }
+        fetch_bound.push_back(m_index);
+        if (p_merge_tree != nullptr) {
+            merge_by_time();
         }
 
         // analyze action
@@ -137,38 +384,342 @@ bool AnalyzerWorkerThread::run(uint32_t coreId)
         wave_analyze();
         double end = __get_double_ts();
         analysis_pkt_num += sum_fetch;
+        if (p_analyzer_config->latency_target > 0) {
+            adapt_batch(sum_fetch, end - last_start, end - start);
+        }
+        if (p_analyzer_config->load_shedding && !m_is_train) {
+            adapt_shedding(backlog_share, end - start);
+        }
+        last_start = end;
+        steal_counter.busy_time += end - start;
+        sum_batch_time += end - start;
+
+        // release the scratch memory of this batch
+        if (p_analyzer_config->arena_verbose && sum_fetch != 0) {
+            const auto & _st = p_arena->batch_stat;
+            LOGF("Analyzer on core # %2d: batch arena [%ld allocs / %ld bytes, overflow %ld allocs / %ld bytes, capacity %ld bytes, high water %ld bytes]",
+            getCoreId(), _st.alloc_num, _st.alloc_size, _st.overflow_num, _st.overflow_size, 
+            p_arena->capacity(), p_arena->high_water);
+        }
+        p_arena->reset();
+
+        // help the busy analyzers, this one is idle until the next wait
+        if (p_analyzer_config->work_steal && !m_is_train && !is_parked.load(memory_order_relaxed)) {
+            const double_t _ss = __get_double_ts();
+            if (steal_tasks() != 0) {
+                steal_counter.busy_time += __get_double_ts() - _ss;
+                p_arena->reset();
+            }
+        }
     }
 
     return true;
 }
 
 
-auto AnalyzerWorkerThread::fetch_form_parser(const shared_ptr<ParserWorkerThread> pt) const -> size_t
+void AnalyzerWorkerThread::run_task(AnalyzerWorkerThread & owner, const FlowTask & task)
+{
+    p_task_owner = &owner;
+    analyze_packets(*task.p_flow, task.p_index, task.n);
+    p_task_owner = this;
+    owner.pending_task_num.fetch_sub(1, memory_order_release);
+}
+
+
+auto AnalyzerWorkerThread::steal_tasks() -> size_t
+{
+    size_t n_task = 0;
+    FlowTask task;
+    bool is_found = true;
+    while (is_found && !m_stop) {
+        is_found = false;
+        for (const auto p_peer : peers) {
+            if (p_peer->task_deque.steal(task)) {
+                run_task(*p_peer, task);
+                p_peer->steal_counter.stolen_num.fetch_add(1, memory_order_relaxed);
+                ++ n_task;
+                is_found = true;
+            }
+        }
+    }
+    steal_counter.steal_num += n_task;
+    return n_task;
+}
+
+
+void AnalyzerWorkerThread::wait_for_parser()
+{
+    // a parked analyzer only keeps its clock moving, so that its flows close
+    if (is_parked.load(memory_order_relaxed)) {
+        usleep(pause_time);
+        return;
+    }
+    if (p_analyzer_config->wait_mode == "busy") {
+        return;
+    }
+    if (p_analyzer_config->wait_mode == "sleep" || wakeup_fd < 0) {
+        usleep(wait_time);
+        return;
+    }
+
+    // the timeout bounds the latency of the flows below the wakeup threshold
+    pollfd pfd = {wakeup_fd, POLLIN, 0};
+    const timespec ts = {(time_t) (wait_time / 1000000), (long) (wait_time % 1000000) * 1000};
+    if (ppoll(&pfd, 1, &ts, nullptr) > 0) {
+        uint64_t cnt;
+        const ssize_t ret = read(wakeup_fd, &cnt, sizeof(cnt));
+        (void) ret;
+        ++ wakeup_event_num;
+    } else {
+        ++ wakeup_timeout_num;
+    }
+}
+
+
+auto AnalyzerWorkerThread::lane_backlog() const -> double_t
+{
+    size_t buffered = 0, capacity = 0;
+    for (const auto & _p : p_lane) {
+        buffered += _p->meta_index;
+        capacity += _p->capacity.load(memory_order_acquire);
+    }
+    return capacity == 0 ? 0 : (double_t) buffered / capacity;
+}
+
+
+void AnalyzerWorkerThread::adapt_shedding(double_t backlog_share, double_t analyze_time)
+{
+    static const double_t alpha = 0.2;
+    auto & _sc = shed_ctrl;
+    const double_t now = __get_double_ts();
+    _sc.backlog = (1 - alpha) * _sc.backlog + alpha * backlog_share;
+    _sc.batch_time = (1 - alpha) * _sc.batch_time + alpha * analyze_time;
+    if (_sc.level_since == 0) {
+        _sc.level_since = now;
+        _sc.calm_since = now;
+    }
+
+    // a level is added while behind, once the last one had time to show its effect,
+    // and removed only after a calm hold time, so that the level does not flap
+    const uint8_t level = shed_level.load(memory_order_relaxed);
+    const double_t hold = p_analyzer_config->shed_hold_time;
+    const bool is_behind = _sc.backlog > p_analyzer_config->shed_up_backlog || 
+                           _sc.batch_time > p_analyzer_config->shed_latency;
+    const bool is_calm = _sc.backlog < p_analyzer_config->shed_down_backlog && 
+                         _sc.batch_time < p_analyzer_config->shed_latency / 2;
+    if (!is_calm) {
+        _sc.calm_since = now;
+    }
+    uint8_t next = level;
+    if (is_behind && level < SHED_PREFIX_ONLY && now - _sc.level_since >= hold / 4) {
+        next = level + 1;
+    } else if (is_calm && level > SHED_NONE && now - _sc.calm_since >= hold) {
+        next = level - 1;
+        _sc.calm_since = now;
+    }
+    if (next == level) {
+        return;
+    }
+
+    _sc.level_time[level] += now - _sc.level_since;
+    _sc.level_since = now;
+    ++ _sc.level_change_num;
+    _sc.max_level = max(_sc.max_level, next);
+    shed_level.store(next, memory_order_relaxed);
+    LOGF("Analyzer on core # %2d: load shedding %s to level %d (%s) [backlog %4.1lf%%, batch %4.1lf ms].",
+    getCoreId(), next > level ? "up" : "down", (int) next, shed_level_name[next], 
+    100.0 * _sc.backlog, _sc.batch_time * 1e3);
+}
+
+
+void AnalyzerWorkerThread::adapt_batch(size_t n_fetch, double_t span, double_t analyze_time)
+{
+    static const double_t alpha = 0.2;
+    const double_t target = p_analyzer_config->latency_target;
+    auto & _bc = batch_ctrl;
+
+    if (n_fetch != 0) {
+        const double_t cost = analyze_time / n_fetch;
+        _bc.pkt_cost = _bc.pkt_cost == 0 ? cost : (1 - alpha) * _bc.pkt_cost + alpha * cost;
+        ++ _bc.batch_num;
+        if (analyze_time > target) {
+            ++ _bc.over_target_num;
+        }
+        _bc.max_batch_time = max(_bc.max_batch_time, analyze_time);
+    }
+    _bc.arrival_rate = (1 - alpha) * _bc.arrival_rate + alpha * (n_fetch / max(span, 1e-6));
+    if (_bc.pkt_cost == 0) {
+        return;
+    }
+
+    // a batch is analyzed within the target
+    const double_t batch_size = target / _bc.pkt_cost;
+    max_fetch = (size_t) min(max(batch_size / p_lane.size(), (double_t) MIN_FETCH_SIZE), (double_t) MAX_FETCH_SIZE);
+
+    // a packet waits for the rest of the wait, then for the analysis of the packets arrived meanwhile:
+    // wait * (1 + rate * cost) = target. A saturated analyzer does not wait at all.
+    const double_t load = _bc.arrival_rate * _bc.pkt_cost;
+    wait_time = load >= 1 ? 0 : (size_t) (1e6 * target / (1 + load));
+}
+
+
+auto AnalyzerWorkerThread::fetch_form_parser(const shared_ptr<ParserLane> pt) const -> size_t
 {
+    // the parser has not allocated the lane yet
+    if (pt->capacity.load(memory_order_acquire) == 0) {
+        return 0;
+    }
+    const size_t lane_capacity = pt->capacity.load(memory_order_relaxed);
+    // the parser only writes behind the buffered packets, so they are copied out of the semaphore,
+    // which guards the offsets only
+    pt->acquire_semaphore();
+    const size_t meta_index = pt->meta_index;
+    const size_t meta_head = pt->meta_head;
+    pt->release_semaphore();
+
     size_t copy_len = 0;
-    size_t new_index = 0;
-    if (pt->meta_index + m_index < meta_pkt_arr_size) {
-        copy_len = pt->meta_index > max_fetch ? max_fetch : pt->meta_index;
+    if (meta_index + m_index < meta_pkt_arr_size) {
+        copy_len = meta_index > max_fetch ? max_fetch : meta_index;
     } else {
         copy_len = min(meta_pkt_arr_size - m_index - 1, max_fetch);
         // WARNF("Analyzer on core # %2d: queue reach max.\n", getCoreId());
     }
-    new_index = pt->meta_index - copy_len;
 
-    // memory copy from registed ParserWorker and reset the buffer
-    memcpy(meta_pkt_arr.get() + m_index, pt->meta_pkt_arr.get(), copy_len * sizeof(PacketMetaData));
+    // memory copy from registed ParserWorker, in two parts when the packets wrap around the ring
+    const size_t first_len = min(copy_len, lane_capacity - meta_head);
+    memcpy(meta_pkt_arr.get() + m_index, pt->meta_pkt_arr.get() + meta_head, first_len * sizeof(PacketMetaData));
+    memcpy(meta_pkt_arr.get() + m_index + first_len, pt->meta_pkt_arr.get(), 
+           (copy_len - first_len) * sizeof(PacketMetaData));
     m_index += copy_len;
-    pt->meta_index = new_index;
+
+    // a partial fetch leaves the rest from the new head, in order, for the next fetch
+    pt->acquire_semaphore();
+    pt->meta_head = meta_head + copy_len < lane_capacity ? meta_head + copy_len : meta_head + copy_len - lane_capacity;
+    pt->meta_index = pt->meta_index - copy_len;
+    // the parser signals again once the buffer passes the threshold
+    pt->is_signalled = false;
+    pt->release_semaphore();
 
     return copy_len;
 }
 
 
+void AnalyzerWorkerThread::merge_by_time()
+{
+    const auto raw_data = meta_pkt_arr.get();
+    const size_t k = p_merge_tree->size();
+
+    // each segment is in the receive order of its parser, nothing to merge if they do not overlap
+    bool is_ordered = true;
+    double_t last_ts = numeric_limits<double_t>::lowest();
+    for (size_t s = 0; s < k && is_ordered; s ++) {
+        if (fetch_bound[s] == fetch_bound[s + 1]) {
+            continue;
+        }
+        is_ordered = raw_data[fetch_bound[s]].time_stamp >= last_ts;
+        last_ts = raw_data[fetch_bound[s + 1] - 1].time_stamp;
+    }
+    if (is_ordered) {
+        return;
+    }
+
+    auto & tree = *p_merge_tree;
+    for (size_t s = 0; s < k; s ++) {
+        merge_head[s] = fetch_bound[s];
+        tree.key(s) = fetch_bound[s] < fetch_bound[s + 1] ? raw_data[fetch_bound[s]].time_stamp : tree.END_KEY;
+    }
+    tree.build();
+
+    const auto p_out = merge_pkt_arr.get();
+    for (size_t i = 0; i < m_index; i ++) {
+        const size_t s = tree.winner();
+        const size_t j = merge_head[s] ++;
+        p_out[i] = raw_data[j];
+        if (j != i) {
+            ++ reorder_pkt_num;
+        }
+        tree.pop(merge_head[s] < fetch_bound[s + 1] ? raw_data[merge_head[s]].time_stamp : tree.END_KEY);
+    }
+    meta_pkt_arr.swap(merge_pkt_arr);
+}
+
+
+#ifdef SPECTRAL_KERNEL_BENCH
+// The original chain of tensor operations, kept as the reference of power_log_scrub
+static auto spectral_chain_legacy(const torch::Tensor & ten_fft) -> torch::Tensor
+{
+    // calculate the power
+    torch::Tensor ten_power = ten_fft.permute({2, 0, 1})[0] * ten_fft.permute({2, 0, 1})[0] + 
+                                ten_fft.permute({2, 0, 1})[1] * ten_fft.permute({2, 0, 1})[1];
+    ten_power = ten_power.squeeze();
+
+    // log linear transformation
+    torch::Tensor ten_res = ((ten_power + 1).log2()).permute({1, 0});
+
+    // erase the inf and nan
+    ten_res = torch::where(torch::isnan(ten_res), torch::full_like(ten_res, 0), ten_res);
+    ten_res = torch::where(torch::isinf(ten_res), torch::full_like(ten_res, 0), ten_res);
+    return ten_res;
+}
+#endif
+
+
+auto AnalyzerWorkerThread::spectrum_transform(const torch::Tensor & ten, size_t r, size_t hop, 
+                                              const torch::Tensor & window) -> torch::Tensor
+{
+    // DFT on flow vector
+    const auto n_fft = resolutions[r].n_fft;
+    torch::Tensor ten_fft = torch::stft(ten, n_fft, (int64_t) hop, (int64_t) n_fft, window).contiguous();
+
+    // power, log linear transformation and erasing the inf and nan in one pass
+    const size_t n_freq = ten_fft.size(0), n_frame = ten_fft.size(1);
+    const auto p_res = p_arena->allocate_array<float>(n_frame * n_freq);
+#ifdef SPECTRAL_KERNEL_BENCH
+    double_t _s_fused = __get_double_ts();
+#endif
+    p_kernel->power_log_scrub(ten_fft.data_ptr<float>(), n_freq, n_frame, p_res);
+    torch::Tensor ten_res = torch::from_blob(p_res, {(long) n_frame, (long) n_freq}, torch::kFloat);
+#ifdef SPECTRAL_KERNEL_BENCH
+    sum_fused_kernel_time += __get_double_ts() - _s_fused;
+    double_t _s_legacy = __get_double_ts();
+    const torch::Tensor ten_legacy = spectral_chain_legacy(ten_fft);
+    sum_legacy_transform_time += __get_double_ts() - _s_legacy;
+    max_fused_kernel_error = max(max_fused_kernel_error, 
+                                (ten_legacy - ten_res).abs().max().item<double_t>());
+#endif
+    return ten_res;
+}
+
+
+auto AnalyzerWorkerThread::center_distance(const torch::Tensor & ten_res, const ClusterModel & model) const -> double_t
+{
+    const auto & centers = model.centers;
+    // window means of the flow as one matrix, scored against all centers by one GEMM.
+    // As the original per-window loop: a window of mean_win_test frames counts when a frame follows it,
+    // up to mean_win_test frames form one window
+    const auto n_dim = ten_res.size(1);
+    torch::Tensor ten_win;
+    if (ten_res.size(0) > p_analyzer_config->mean_win_test) {
+        const auto n_win = (ten_res.size(0) - 1) / p_analyzer_config->mean_win_test;
+        ten_win = ten_res.slice(0, 0, n_win * p_analyzer_config->mean_win_test)
+                    .view({(long) n_win, (long) p_analyzer_config->mean_win_test, n_dim}).mean(1);
+    } else {
+        ten_win = ten_res.mean(0).view({1, n_dim});
+    }
+    ten_win = ten_win.contiguous();
+    const torch::Tensor ten_dot = torch::mm(ten_win, centers.t()).contiguous();
+    return p_kernel->max_min_center_dist(ten_win.data_ptr<float>(), ten_dot.data_ptr<float>(), 
+                                         model.center_norms.data_ptr<float>(), 
+                                         ten_win.size(0), n_dim, centers.size(0),
+                                         p_analyzer_config->alert_distance);
+}
+
+
 void AnalyzerWorkerThread::wave_analyze()
 {
-    const auto cur_len = m_index;
+    auto cur_len = m_index;
     const auto raw_data = meta_pkt_arr.get();
-    static const double_t min_interval_time = 1e-5;
+    const uint8_t level = shed_level.load(memory_order_relaxed);
 
 
 #ifdef DETAIL_TIME_ANALYZE
@@ -177,18 +728,111 @@ void AnalyzerWorkerThread::wave_analyze()
     ++ analyze_entrance;
 #endif
 #endif
-    // address aggregate
-    unordered_map<uint32_t, vector<size_t> > mp;
+    // keep the clock moving on wall time while no packet arrives, so that idle flows and epochs still close
+    if (cur_len == 0 && analysis_clock > 0) {
+        analysis_clock = max(analysis_clock, __get_double_ts() - clock_offset);
+    }
+
+    // load shedding keeps the same share of sources in every view, all packets of a source or none.
+    // The clock still follows the dropped packets
+    if (level >= SHED_SAMPLE) {
+        const double_t keep = p_analyzer_config->shed_sample_ratio * UINT32_MAX;
+        size_t n_keep = 0;
+        for (size_t i = 0; i < cur_len; i ++) {
+            if ((shed_hash(raw_data[i].address) >> 32) < keep) {
+                raw_data[n_keep ++] = raw_data[i];
+            } else {
+                analysis_clock = max(analysis_clock, raw_data[i].time_stamp);
+            }
+        }
+        shed_ctrl.sample_pkt_num += cur_len - n_keep;
+        cur_len = n_keep;
+    }
+
+    // finalize and evict the flows gone idle, before the admission of new sources
+    const auto finalize_func = [this] (FlowState & flow) -> void {
+        finalize_flow(flow);
+    };
+    for (auto & view : views) {
+        view.p_flow_table->evict_idle(analysis_clock, p_analyzer_config->flush_idle_time, finalize_func);
+        view.p_aggregate_table->evict_idle(analysis_clock, p_analyzer_config->flush_idle_time, finalize_func);
+    }
+
+    // heavy hitters of the last epoch, whose flows are analyzed first
+    if (p_heavy_hitter != nullptr) {
+        update_heavy_hitter();
+    }
+
+    // address aggregate, the packet indexes of each flow are placed contiguously in the batch arena.
+    // A new address is admitted to the flow table while it has room, otherwise its prefix is analyzed
+    // as one flow, so that the batch cost stays bounded under a spoofed-address flood.
+    // All views are grouped in the same pass, a packet belongs to one flow of each view.
+    const size_t n_view = views.size();
+    const size_t n_entry = cur_len * n_view;
+    batch_map_t mp(n_entry / 8 + 1, batch_hash, equal_to<uint64_t>(), 
+                   batch_map_t::allocator_type(p_arena.get()));
+    const auto flow_of_pkt = p_arena->allocate_array<uint32_t>(n_entry);
+    const auto flow_key = p_arena->allocate_array<uint64_t>(n_entry);
+    const auto flow_cursor = p_arena->allocate_array<size_t>(n_entry);
+    size_t n_flow = 0;
+    const size_t max_flow_num = p_analyzer_config->max_flow_num;
+    const size_t max_aggregate_num = p_analyzer_config->max_aggregate_num;
+    const auto admit_room = p_arena->allocate_array<size_t>(n_view);
+    const auto aggregate_room = p_arena->allocate_array<size_t>(n_view);
+    // load shedding admits no new address, as if the flow tables were full
+    const bool prefix_only = level >= SHED_PREFIX_ONLY;
+    for (size_t v = 0; v < n_view; v ++) {
+        const size_t flow_num = views[v].p_flow_table->size();
+        const size_t aggregate_num = views[v].p_aggregate_table->size();
+        admit_room[v] = max_flow_num == 0 ? SIZE_MAX : (max_flow_num > flow_num ? max_flow_num - flow_num : 0);
+        if (prefix_only) {
+            admit_room[v] = 0;
+        }
+        aggregate_room[v] = max_aggregate_num > aggregate_num ? max_aggregate_num - aggregate_num : 0;
+    }
+    double_t batch_first_ts = numeric_limits<double_t>::max();
     for (size_t i = 0; i < cur_len; i++) {
-        // the tag for aggragrate
-        uint32_t addr = (ntohl(raw_data[i].address));
         analysis_pkt_len += raw_data[i].pkt_length;
-        if(mp.find(addr) == mp.end()){
-            mp.insert(pair<uint32_t, vector<size_t> >(
-                addr, vector<size_t>())
-            );
+        analysis_clock = max(analysis_clock, raw_data[i].time_stamp);
+        batch_first_ts = min(batch_first_ts, raw_data[i].time_stamp);
+
+        for (size_t v = 0; v < n_view; v ++) {
+            // the tag for aggragrate
+            const uint32_t addr = ntohl(views[v].is_destination ? raw_data[i].dst_address : raw_data[i].address);
+            if (v == 0 && p_heavy_hitter != nullptr) {
+                p_heavy_hitter->update(addr);
+            }
+
+            const uint64_t view_tag = (uint64_t) v << VIEW_KEY_SHIFT;
+            uint64_t key = view_tag | addr;
+            if (mp.count(key) == 0 && views[v].p_flow_table->find(addr) == nullptr) {
+                if (admit_room[v] != 0) {
+                    -- admit_room[v];
+                } else {
+                    ++ (prefix_only ? shed_ctrl.prefix_pkt_num : overflow_pkt_num);
+                    key = aggregate_key(addr, v, aggregate_room[v], mp);
+                }
+            }
+
+            const auto ite = mp.emplace(key, n_flow);
+            if (ite.second) {
+                flow_key[n_flow] = key;
+                flow_cursor[n_flow] = 0;
+                ++ n_flow;
+            }
+            flow_of_pkt[i * n_view + v] = ite.first->second;
+            ++ flow_cursor[ite.first->second];
         }
-        mp[addr].push_back(i);
+    }
+    const auto flow_begin = p_arena->allocate_array<size_t>(n_flow + 1);
+    flow_begin[0] = 0;
+    for (size_t f = 0; f < n_flow; f ++) {
+        flow_begin[f + 1] = flow_begin[f] + flow_cursor[f];
+        flow_cursor[f] = flow_begin[f];
+    }
+    const auto pkt_index = p_arena->allocate_array<size_t>(n_entry);
+    for (size_t j = 0; j < n_entry; j++) {
+        pkt_index[flow_cursor[flow_of_pkt[j]] ++] = j / n_view;
     }
 #ifdef DETAIL_TIME_ANALYZE
     sum_aggregate_time +=  __get_double_ts() - s;
@@ -196,193 +840,847 @@ void AnalyzerWorkerThread::wave_analyze()
 
     // clear the buffer
     m_index = 0;
+    if (cur_len != 0) {
+        clock_offset = __get_double_ts() - analysis_clock;
+    }
+
+    // the flows of heavy hitters first, the others are skipped when restricted,
+    // and the ones not filling a frame of the primary resolution when the load is shed
+    const auto flow_order = p_arena->allocate_array<uint32_t>(n_flow);
+    size_t n_order = 0;
+    for (size_t f = 0; f < n_flow; f ++) {
+        if (is_heavy_hitter(flow_key[f])) {
+            flow_order[n_order ++] = f;
+        }
+    }
+    const bool restrict_heavy = p_analyzer_config->heavy_hitter_restrict && !m_is_train && !heavy_keys.empty();
+    const bool skip_low = level >= SHED_SKIP_LOW;
+    for (size_t f = 0; f < n_flow; f ++) {
+        if (is_heavy_hitter(flow_key[f])) {
+            continue;
+        }
+        // the restriction applies to the host flows of the first view
+        const size_t n_pkt = flow_begin[f + 1] - flow_begin[f];
+        if (restrict_heavy && (flow_key[f] >> 32) == 0) {
+            heavy_hitter_skip_pkt_num += n_pkt;
+            continue;
+        }
+        if (skip_low && (flow_key[f] >> 32) == 0 && n_pkt < p_analyzer_config->n_fft) {
+            shed_ctrl.skip_pkt_num += n_pkt;
+            continue;
+        }
+        flow_order[n_order ++] = f;
+    }
+
+    // an empty epoch wheel jumps to the first epoch of the batch, the epoch ends scheduled below come after it
+    if (p_analyzer_config->epoch_time > 0 && cur_len != 0 && p_epoch_wheel->size() == 0) {
+        p_epoch_wheel->advance(epoch_tick(epoch_of(batch_first_ts)), [] (uint64_t, uint64_t) -> void {});
+    }
+
+    // in execution mode, the flows staying in their open epoch are tasks that idle analyzers steal
+    const bool is_steal = p_analyzer_config->work_steal && !m_is_train && !peers.empty();
+    const auto flow_ptr = p_arena->allocate_array<FlowState *>(n_order);
+    size_t n_task = 0;
+    for (size_t o = 0; o < n_order; o ++) {
+
+        const size_t f = flow_order[o];
+        const auto _ve = pkt_index + flow_begin[f];
+        const size_t _ve_len = flow_begin[f + 1] - flow_begin[f];
+        auto & flow = find_or_insert_flow(flow_key[f]);
+        flow_ptr[o] = &flow;
+
+        if (is_steal) {
+            // the epoch of the first packet is opened here, the flows crossing an epoch stay sequential
+            bool in_epoch = true;
+            if (p_analyzer_config->epoch_time > 0) {
+                const int64_t epoch = max(epoch_of(raw_data[_ve[0]].time_stamp), flow.epoch_id);
+                for (size_t i = 1; i < _ve_len && in_epoch; i ++) {
+                    in_epoch = epoch_of(raw_data[_ve[i]].time_stamp) <= epoch;
+                }
+                if (in_epoch && epoch != flow.epoch_id) {
+                    if (flow.epoch_id >= 0) {
+                        close_epoch(flow);
+                    }
+                    flow.epoch_id = epoch;
+                    p_epoch_wheel->schedule(key_of_flow(flow), epoch_tick(epoch + 1));
+                }
+            }
+            if (in_epoch) {
+                pending_task_num.fetch_add(1, memory_order_relaxed);
+                task_deque.push({&flow, _ve, _ve_len});
+                // wake the idle analyzers once there is something to steal
+                if (++ n_task == 2) {
+                    for (const auto p_peer : peers) {
+                        p_peer->signal_wakeup();
+                    }
+                }
+                continue;
+            }
+        }
 
-    decltype(mp)::const_iterator iter_mp;
-    for (iter_mp = mp.cbegin(); iter_mp != mp.cend(); iter_mp++) {
+        // split the packets of the flow by epoch, a late packet stays in the current epoch
+        size_t seg_begin = 0;
+        while (p_analyzer_config->epoch_time > 0 && seg_begin < _ve_len) {
+            const int64_t epoch = max(epoch_of(raw_data[_ve[seg_begin]].time_stamp), flow.epoch_id);
+            if (epoch != flow.epoch_id) {
+                if (flow.epoch_id >= 0) {
+                    close_epoch(flow);
+                }
+                flow.epoch_id = epoch;
+                p_epoch_wheel->schedule(key_of_flow(flow), epoch_tick(epoch + 1));
+            }
+            size_t seg_end = seg_begin + 1;
+            while (seg_end < _ve_len && epoch_of(raw_data[_ve[seg_end]].time_stamp) <= epoch) {
+                ++ seg_end;
+            }
+            analyze_packets(flow, _ve + seg_begin, seg_end - seg_begin);
+            seg_begin = seg_end;
+        }
+        if (p_analyzer_config->epoch_time <= 0) {
+            analyze_packets(flow, _ve, _ve_len);
+        }
 
-        const auto & _ve = iter_mp->second;
-        if(_ve.size() < 2 * p_analyzer_config->n_fft) {
+        // no flow is evicted while a task may hold it
+        if (is_steal) {
             continue;
         }
+        auto & table = table_of(flow);
+        table.touch(flow);
+        table.evict_over_budget(finalize_func);
+    }
 
-        // calculate time interval
-        for (size_t i = _ve.size() - 1; i > 0; i --) {
-            raw_data[_ve[i]].time_stamp -= raw_data[_ve[i - 1]].time_stamp;
-            if (raw_data[_ve[i]].time_stamp <= 0) {
-                raw_data[_ve[i]].time_stamp = min_interval_time;
+    if (is_steal) {
+        steal_counter.task_num += n_task;
+        FlowTask task;
+        while (task_deque.pop(task)) {
+            run_task(*this, task);
+        }
+        // the tasks stolen by others, help the other analyzers meanwhile
+        while (pending_task_num.load(memory_order_acquire) != 0) {
+            if (steal_tasks() == 0) {
+                this_thread::yield();
             }
         }
-        raw_data[_ve[0]].time_stamp = min_interval_time;
 
+        for (size_t o = 0; o < n_order; o ++) {
+            table_of(*flow_ptr[o]).touch(*flow_ptr[o]);
+        }
+        for (auto & view : views) {
+            view.p_flow_table->evict_over_budget(finalize_func);
+            view.p_aggregate_table->evict_over_budget(finalize_func);
+        }
+    }
 
-        // packet encoding
+    // close the epochs ended before the current clock
+    if (p_analyzer_config->epoch_time > 0) {
+        p_epoch_wheel->advance(epoch_tick(analysis_clock / p_analyzer_config->epoch_time), 
+                               [this] (uint64_t key, uint64_t tick) -> void {
+            const auto p_flow = find_flow(key);
+            // stale entry, the flow moved to a later epoch
+            if (p_flow == nullptr || p_flow->epoch_id < 0 || epoch_tick(p_flow->epoch_id + 1) > tick) {
+                return;
+            }
+            close_epoch(*p_flow);
+        });
+    }
+
+    // in training, pause once the whole batch is fed, so that the learner takes the samples
+    if (is_train_fed) {
+        is_train_fed = false;
+        usleep(50000);
+    }
+}
+
+
+void AnalyzerWorkerThread::update_heavy_hitter()
+{
+    const double_t epoch_len = p_analyzer_config->epoch_time > 0 ? 
+                               p_analyzer_config->epoch_time : p_analyzer_config->verbose_interval;
+    const int64_t epoch = (int64_t) floor(analysis_clock / epoch_len);
+    if (epoch == heavy_hitter_epoch) {
+        return;
+    }
+    heavy_hitter_epoch = epoch;
+
+    // the top-K of the closed epoch, then the counters of older epochs fade out
+    heavy_hitter_list = p_heavy_hitter->top(p_analyzer_config->heavy_hitter_k);
+    p_heavy_hitter->decay();
+
+    heavy_keys.clear();
+    for (const auto & c : heavy_hitter_list) {
+        // only the sources with at least one frame of packets guaranteed
+        if (c.count - c.error >= p_analyzer_config->n_fft) {
+            heavy_keys.push_back(c.key);
+        }
+    }
+    sort(heavy_keys.begin(), heavy_keys.end());
+}
+
+
+auto AnalyzerWorkerThread::is_heavy_hitter(uint64_t key) const -> bool
+{
+    // a host flow of the first view
+    return (key >> 32) == 0 && binary_search(heavy_keys.cbegin(), heavy_keys.cend(), (uint32_t) key);
+}
+
+
+auto AnalyzerWorkerThread::aggregate_key(uint32_t addr, size_t v, size_t & aggregate_room, 
+                                         const batch_map_t & mp) -> uint64_t
+{
+    const uint64_t view_tag = (uint64_t) v << VIEW_KEY_SHIFT;
+    const uint32_t prefix = addr & prefix_mask(p_analyzer_config->aggregate_prefix_len);
+    const uint64_t key = view_tag | AGGREGATE_KEY_TAG | prefix;
+    if (mp.count(key) != 0 || views[v].p_aggregate_table->find(prefix) != nullptr) {
+        return key;
+    }
+    if (aggregate_room != 0) {
+        -- aggregate_room;
+        return key;
+    }
+    // the prefixes are exhausted as well, fold into the /8 of the address (the low bit tags the fold)
+    ++ fold_pkt_num;
+    return view_tag | AGGREGATE_KEY_TAG | (addr & prefix_mask(8)) | 1;
+}
+
+
+auto AnalyzerWorkerThread::find_flow(uint64_t key) -> FlowState *
+{
+    const auto & view = views[key >> VIEW_KEY_SHIFT];
+    return (key & AGGREGATE_KEY_TAG) ? view.p_aggregate_table->find((uint32_t) key) : 
+                                       view.p_flow_table->find((uint32_t) key);
+}
+
+
+auto AnalyzerWorkerThread::find_or_insert_flow(uint64_t key) -> FlowState &
+{
+    const auto & view = views[key >> VIEW_KEY_SHIFT];
+    auto & flow = (key & AGGREGATE_KEY_TAG) ? view.p_aggregate_table->find_or_insert((uint32_t) key) : 
+                                              view.p_flow_table->find_or_insert((uint32_t) key);
+    flow.view = (uint8_t) (key >> VIEW_KEY_SHIFT);
+    if (key & AGGREGATE_KEY_TAG) {
+        flow.prefix_len = (key & 1) ? 8 : p_analyzer_config->aggregate_prefix_len;
+    }
+    return flow;
+}
+
+
+void AnalyzerWorkerThread::analyze_packets(FlowState & flow, const size_t * p_index, size_t n)
+{
+    const auto raw_data = p_task_owner->meta_pkt_arr.get();
+    const bool is_sliding = p_analyzer_config->spectrum_mode == "sliding";
+
+    // packet encoding once for all resolutions, continue from the last packet of previous batches
 #ifdef DETAIL_TIME_ANALYZE
-        double_t _s0 = __get_double_ts();
+    double_t _s0 = __get_double_ts();
 #endif
-        torch::Tensor ten = torch::zeros(_ve.size());
-        for (int i = 0; i < _ve.size(); i++) {
-            ten[i] = weight_transform(raw_data[_ve[i]]);
-        }
+    float * p_enc = nullptr;
+    if (is_sliding) {
+        p_enc = p_arena->allocate_array<float>(n);
+    } else {
+        const size_t tail_len = flow.sample_tail.size();
+        flow.sample_tail.resize(tail_len + n);
+        p_enc = flow.sample_tail.data() + tail_len;
+    }
+    p_kernel->encode_packets(raw_data, p_index, n, flow.last_ts, p_enc);
+    // in sliding mode, keep the samples before the first frame in case the flow ends short
+    const auto & view = p_task_owner->views[flow.view];
+    if (is_sliding && flow.pkt_num < p_analyzer_config->n_fft && view.p_low_rate_sketch != nullptr) {
+        flow.sample_tail.insert(flow.sample_tail.end(), p_enc, 
+                                p_enc + min(n, p_analyzer_config->n_fft - flow.pkt_num));
+    }
+    flow.last_ts = raw_data[p_index[n - 1]].time_stamp;
+    for (auto & sp : flow.spectrum) {
+        sp.pending_pkt_num += n;
+    }
+    flow.pkt_num += n;
 #ifdef DETAIL_TIME_ANALYZE
-        sum_weight_time += __get_double_ts() - _s0;
+    sum_weight_time += __get_double_ts() - _s0;
 #endif
 
+    // first stage, running statistics of the flow without FFT
+    if (p_analyzer_config->cascade_gate) {
+        const double_t _sc = __get_double_ts();
+        cascade_stage(flow, p_index, n);
+        cascade_counter.stage_time += __get_double_ts() - _sc;
+    }
+
+    // in STFT mode, a resolution waits for two frames of new samples
+    bool any_ready = is_sliding;
+    for (size_t r = 0; r < resolutions.size() && !any_ready; r ++) {
+        any_ready = flow.sample_tail.size() - flow.spectrum[r].sample_offset >= 2 * resolutions[r].n_fft;
+    }
+    if (!any_ready) {
+        return;
+    }
+
+    // a usual flow skips the frequency domain analysis
+    const size_t path_pkt_num = is_sliding ? n : flow.sample_tail.size();
+    if (!flow.cascade_pass && !m_is_train) {
+        cascade_counter.gate_pkt_num += path_pkt_num;
+        cascade_gate(flow);
+        return;
+    }
 
-        // frequency domain analysis
+    // frequency domain analysis at each resolution
+    const double_t _s1 = p_analyzer_config->cascade_gate ? __get_double_ts() : 0;
+    bool is_fed = false;
+    const bool is_pipelined = !out_rings.empty() && !m_is_train;
+    for (size_t r = 0; r < resolutions.size(); r ++) {
+        auto & sp = flow.spectrum[r];
+        // the complete scoring windows go down the pipeline
+        if (is_pipelined) {
+            ship_flow(flow, r, false);
+            continue;
+        }
 #ifdef DETAIL_TIME_ANALYZE
-        double_t _s1 = __get_double_ts();
+        double_t _s2 = __get_double_ts();
 #endif
-        // DFT on flow vector
-        torch::Tensor ten_fft = torch::stft(ten, p_analyzer_config->n_fft);
-
-        // calculate the power
-        torch::Tensor ten_power = ten_fft.permute({2, 0, 1})[0] * ten_fft.permute({2, 0, 1})[0] + 
-                                    ten_fft.permute({2, 0, 1})[1] * ten_fft.permute({2, 0, 1})[1];
-        ten_power = ten_power.squeeze();
+        torch::Tensor ten_res;
+        if (is_sliding) {
+            ten_res = slide_flow(flow, r, p_enc, n);
+        } else if (flow.sample_tail.size() - sp.sample_offset >= 2 * resolutions[r].n_fft) {
+            ten_res = transform_flow(flow, r);
+        } else {
+            continue;
+        }
+#ifdef DETAIL_TIME_ANALYZE
+        sum_transform_time += __get_double_ts() - _s2;
+#endif
+        if (ten_res.size(0) == 0) {
+            continue;
+        }
 
-        // log linear transformation
-        torch::Tensor ten_res = ((ten_power + 1).log2()).permute({1, 0});
+        if (m_is_train) {
+            if (view.models[r].is_train) {
+                feed_learner(ten_res, r, flow.view);
+            }
+            sp.frame_tail.clear();
+            is_fed = true;
+            continue;
+        }
 
-        // erase the inf and nan
-        ten_res = torch::where(torch::isnan(ten_res), torch::full_like(ten_res, 0), ten_res);
-        ten_res = torch::where(torch::isinf(ten_res), torch::full_like(ten_res, 0), ten_res);
+        // In testing phase, calculate the min distance of the cluster centers
+#ifdef DETAIL_TIME_ANALYZE
+        double_t _s3 = __get_double_ts();
+#endif
+        score_flow(flow, r, false);
 #ifdef DETAIL_TIME_ANALYZE
-        sum_transform_time += __get_double_ts() - _s1;
+        sum_dist_time += __get_double_ts() - _s3;
 #endif
+    }
+    if (!is_sliding) {
+        flow.trim_samples();
+    }
 
+    if (is_fed) {
+        is_train_fed = true;
+        return;
+    }
+    if (p_analyzer_config->cascade_gate) {
+        cascade_counter.fft_time += __get_double_ts() - _s1;
+        cascade_counter.fft_pkt_num += path_pkt_num;
+    }
+}
 
-        if (m_is_train) {
-            // feed data to learner
-            torch::Tensor ten_temp;
-            if (ten_res.size(0) > p_analyzer_config->mean_win_train + 1 && !p_learner->reach_learn()) {
-                vector<vector<double_t> > data_to_add;
-                for (size_t i = 0; i < p_analyzer_config->num_train_sample; i ++) {
-                    size_t start_index = rand() % (ten_res.size(0) - 1 - p_analyzer_config->mean_win_train);
-                    ten_temp = ten_res.slice(0, start_index, start_index + p_analyzer_config->mean_win_train).mean(0);
-                    vector<double_t> _dt;
-                    for(size_t j = 0; j < ten_temp.size(0); j ++) {
-                        _dt.push_back((double_t) ten_temp[j].item<double_t>());
-                    }
-                    data_to_add.push_back(_dt);
-                }
 
-                p_learner->acquire_semaphore_data();
-                p_learner->add_train_data(data_to_add);
-                p_learner->release_semaphore_data();
+void AnalyzerWorkerThread::flush_flow(FlowState & flow)
+{
+    if (m_is_train) {
+        return;
+    }
+    for (size_t r = 0; r < resolutions.size(); r ++) {
+        if (!out_rings.empty()) {
+            ship_flow(flow, r, true);
+            continue;
+        }
+        if (p_analyzer_config->spectrum_mode == "stft" && 
+            flow.sample_tail.size() - flow.spectrum[r].sample_offset >= resolutions[r].n_fft) {
+            transform_flow(flow, r);
+        }
+        score_flow(flow, r, true);
+    }
+    if (p_analyzer_config->spectrum_mode == "stft") {
+        flow.trim_samples();
+    }
+}
 
-            } else {
-                ten_temp =  ten_res.mean(0);
-                vector<double_t> data_to_add;
-                for(size_t j = 0; j < ten_temp.size(0); j ++) {
-                    data_to_add.push_back((double_t) ten_temp[j].item<double_t>());
-                }
-                
-                p_learner->acquire_semaphore_data();
-                p_learner->add_train_data(data_to_add);
-                p_learner->release_semaphore_data();
-
-            }
-            
-            // can start train, but none start train
-            p_learner->acquire_semaphore_learn();
-            if (p_learner->reach_learn() && !p_learner->start_learn) {
-                if (p_analyzer_config->mode_verbose) {
-                    LOGF("Analyer on core %2d: trigger the training of learner.", getCoreId());
-                }
-                p_learner->start_train();
-                p_learner->release_semaphore_learn();
-            } else {
-                p_learner->release_semaphore_learn();
-            }
 
-            // train is finished, but still train
-            if (p_learner->finish_learn && m_is_train) {
-                m_is_train = false;
-                analysis_start_time = __get_double_ts();
+void AnalyzerWorkerThread::cascade_stage(FlowState & flow, const size_t * p_index, size_t n)
+{
+    const auto raw_data = p_task_owner->meta_pkt_arr.get();
+    for (size_t i = 0; i < n; i ++) {
+        flow.cascade_stat.update(raw_data[p_index[i]]);
+    }
+    if (flow.cascade_stat.pkt_num < p_analyzer_config->n_fft) {
+        return;
+    }
 
-                // clear the counter
-                analysis_pkt_len = 0;
-                analysis_pkt_num = 0;
+    // decide on every n_fft packets of the flow, by the model of its view
+    const auto & p_cascade = p_task_owner->views[flow.view].p_cascade;
+    if (m_is_train) {
+        p_cascade->learn(flow.cascade_stat);
+        flow.cascade_pass = true;
+    } else if (!p_cascade->ready()) {
+        flow.cascade_pass = true;
+    } else {
+        flow.cascade_pass = p_cascade->is_unusual(flow.cascade_stat, p_analyzer_config->cascade_bound_z) || 
+                            gate_dist(gate_rng) < p_analyzer_config->cascade_sample;
+        ++ cascade_counter.decision_num;
+        if (!flow.cascade_pass) {
+            ++ cascade_counter.gate_num;
+        }
+    }
+    flow.cascade_stat.reset();
+}
 
-                // copy training results from learner (clustering centers)
-                const auto & train_res = p_learner->train_result;
-                for (size_t i = 0; i < train_res.size(); i ++) {
-                    for (size_t j = 0; j < train_res[0].size(); j ++) {
-                        centers[i][j] = train_res[i][j];
-                    }
-                }
 
-                if(p_analyzer_config->mode_verbose) {
-                    LOGF("Analyer on core %2d: enter execution mode.", getCoreId());
-                }
-                
-                if(getCoreId() == p_analyzer_config->verbose_center_core && 
-                    p_analyzer_config->center_verbose) {
-                    for (size_t i = 0; i < centers.size(0); i ++) {
-                        cout << centers[i] << endl;
-                    }
-                }
-            }
-            usleep(50000);
-            return;
+void AnalyzerWorkerThread::cascade_gate(FlowState & flow)
+{
+    // the spectrum restarts when the flow becomes unusual again
+    if (p_analyzer_config->spectrum_mode == "stft") {
+        flow.clear_samples();
+    }
+    for (size_t r = 0; r < resolutions.size(); r ++) {
+        auto & sp = flow.spectrum[r];
+        sp.p_sdft.reset();
+        if (!sp.frame_tail.empty()) {
+            score_flow(flow, r, true);
+        } else if (sp.pending_pkt_num >= resolutions[r].n_fft) {
+            // the verdict of the first stage: normal, recorded apart from the scores
+            p_task_owner->record_result(flow.address & prefix_mask(flow.prefix_len), flow.prefix_len, 0, 
+                                        sp.pending_pkt_num, resolutions[r].n_fft, 
+                                        p_task_owner->views[flow.view].is_destination, RECORD_GATED);
+            sp.pending_pkt_num = 0;
         }
+    }
+}
 
 
-        // In testing phase, calculate the min distance of the cluster centers
-#ifdef DETAIL_TIME_ANALYZE
-        double_t _s2 = __get_double_ts();
-#endif
-        double min_dist = max_cluster_dist;
-        if (ten_res.size(0) > p_analyzer_config->mean_win_test) {
-            double_t _max_dist = 0;
-            for (size_t i = 0; 
-                i + p_analyzer_config->mean_win_test < ten_res.size(0); 
-                i += p_analyzer_config->mean_win_test) {
-                torch::Tensor tt =  ten_res.slice(0, i, i + p_analyzer_config->mean_win_test).mean(0);
-                double_t _min_dist = max_cluster_dist;
-                for (size_t j = 0; j < centers.size(0); j ++) {
-                    double_t d = torch::norm(tt - centers[j]).item<double_t>();
-                    _min_dist = min(_min_dist, d);
-                }
-                _max_dist = max(_max_dist, _min_dist);
-            }
-            min_dist = _max_dist;
+void AnalyzerWorkerThread::finalize_flow(FlowState & flow)
+{
+    if (m_is_train) {
+        return;
+    }
+    if (is_short_flow(flow)) {
+        fold_low_rate(flow);
+        return;
+    }
+    if (flow.pkt_num < p_analyzer_config->finalize_min_pkt) {
+        return;
+    }
+    flush_flow(flow);
+    ++ table_of(flow).stat.finalize_num;
+}
+
+
+void AnalyzerWorkerThread::close_epoch(FlowState & flow)
+{
+    if (is_short_flow(flow)) {
+        fold_low_rate(flow);
+    } else {
+        flush_flow(flow);
+    }
+    // the samples short of a frame are carried to the next epoch, so that a flow slower than
+    // n_fft packets per epoch is still analyzed
+    flow.epoch_id = -1;
+
+    // release the frames consumed by the flush, the flow may stay idle until its eviction
+    for (auto & sp : flow.spectrum) {
+        if (sp.frame_tail.empty()) {
+            sp.frame_tail.shrink_to_fit();
+        }
+    }
+    flow.sample_tail.shrink_to_fit();
+    table_of(flow).reaccount(flow);
+}
+
+
+auto AnalyzerWorkerThread::is_short_flow(const FlowState & flow) const -> bool
+{
+    // nothing to score, and too few samples for one frame at the primary resolution
+    const auto & sp = flow.spectrum[0];
+    const size_t n_sample = flow.sample_tail.size() - sp.sample_offset;
+    return views[flow.view].p_low_rate_sketch != nullptr && sp.frame_tail.empty() && n_sample != 0 && 
+           n_sample < p_analyzer_config->n_fft;
+}
+
+
+void AnalyzerWorkerThread::fold_low_rate(FlowState & flow)
+{
+    if (m_is_train) {
+        return;
+    }
+    // the sketch is analyzed at the primary resolution
+    auto & sp = flow.spectrum[0];
+    const uint32_t prefix = flow.address & prefix_mask(p_analyzer_config->aggregate_prefix_len);
+    const auto & view = views[flow.view];
+    view.p_low_rate_sketch->fold(prefix, flow.sample_tail.data() + sp.sample_offset, 
+                            flow.sample_tail.size() - sp.sample_offset, sp.pending_pkt_num, 
+                            [this, &view] (size_t index, LowRateSketch::Bucket & bucket) -> void {
+        // the series of a bucket is analyzed like a flow, and reported per prefix unless mixed
+        const auto & res = resolutions[0];
+        torch::Tensor ten = torch::from_blob(bucket.series.data(), {(long) bucket.series.size()}, torch::kFloat);
+        const double_t min_dist = center_distance(spectrum_transform(ten, 0, res.stft_hop, res.stft_window), 
+                                                 view.models[0]);
+        if (bucket.mixed) {
+            record_result((uint32_t) index, 0, min_dist, bucket.pkt_num, res.n_fft, view.is_destination, 
+                          RECORD_MIXED);
         } else {
-            torch::Tensor tt = ten_res.mean(0);
-            for (size_t j = 0; j < centers.size(0); j ++) {
-                double d = torch::norm(tt - centers[j]).item<double_t>();
-                min_dist = min(min_dist, d);
+            record_result(bucket.prefix, p_analyzer_config->aggregate_prefix_len, min_dist, bucket.pkt_num, 
+                          res.n_fft, view.is_destination);
+        }
+    });
+    flow.clear_samples();
+    for (auto & _sp : flow.spectrum) {
+        _sp.pending_pkt_num = 0;
+    }
+}
+
+
+auto AnalyzerWorkerThread::transform_flow(FlowState & flow, size_t r) -> torch::Tensor
+{
+    const auto & res = resolutions[r];
+    auto & sp = flow.spectrum[r];
+
+    // the samples not consumed by this resolution
+    torch::Tensor ten = torch::from_blob(flow.sample_tail.data() + sp.sample_offset, 
+                                         {(long) (flow.sample_tail.size() - sp.sample_offset)}, torch::kFloat);
+    const size_t hop = p_task_owner->frame_hop(r);
+    const torch::Tensor ten_res = spectrum_transform(ten, r, hop, res.stft_window);
+
+    // compare with the reference (accurate) analysis profile on sampled flows
+    if (!m_is_train && p_analyzer_config->profile_drift_sample > 0 && 
+        (flow.address * 2654435761u) < p_analyzer_config->profile_drift_sample * UINT32_MAX) {
+        const double_t _s_drift = __get_double_ts();
+        const auto & model = p_task_owner->views[flow.view].models[r];
+        const double_t cur_dist = center_distance(ten_res, model);
+        const double_t ref_dist = center_distance(spectrum_transform(ten, r, res.reference_hop, torch::Tensor()), model);
+        sum_profile_drift += fabs(ref_dist - cur_dist);
+        max_profile_drift = max(max_profile_drift, fabs(ref_dist - cur_dist));
+        ++ profile_drift_num;
+        run_sum_profile_drift += fabs(ref_dist - cur_dist);
+        run_max_profile_drift = max(run_max_profile_drift, fabs(ref_dist - cur_dist));
+        ++ run_profile_drift_num;
+        profile_drift_time += __get_double_ts() - _s_drift;
+    }
+
+    // keep the samples after the last complete frame for the next batch
+    const size_t n_frame = ten_res.size(0);
+    sp.sample_offset += n_frame * hop;
+
+    // frames wait for a complete scoring window
+    const auto p_res = ten_res.data_ptr<float>();
+    sp.frame_tail.insert(sp.frame_tail.end(), p_res, p_res + n_frame * res.n_freq);
+    return ten_res;
+}
+
+
+auto AnalyzerWorkerThread::slide_flow(FlowState & flow, size_t r, const float * p_enc, size_t n) -> torch::Tensor
+{
+    const auto & res = resolutions[r];
+    const auto n_freq = res.n_freq;
+    auto & sp = flow.spectrum[r];
+    // a sliding DFT keeps the hop it starts with, the frame bound below holds for any hop from stft_hop
+    if (sp.p_sdft == nullptr) {
+        sp.p_sdft = make_unique<SlidingDft>(res.n_fft, p_task_owner->frame_hop(r));
+    }
+
+    // O(n_freq) update per packet, a frame is emitted every hop packets
+    const auto p_spec = p_arena->allocate_array<float>(2 * n_freq);
+    const auto p_res = p_arena->allocate_array<float>((n / res.stft_hop + 1) * n_freq);
+    size_t n_frame = 0;
+    for (size_t i = 0; i < n; i ++) {
+        if (sp.p_sdft->push(p_enc[i], res.sdft_twiddle.data())) {
+            sp.p_sdft->frame(sdft_window_a0, sdft_window_a1, p_spec);
+            p_kernel->power_log_scrub(p_spec, n_freq, 1, p_res + n_frame * n_freq);
+            ++ n_frame;
+        }
+    }
+
+    // the samples kept for the low-rate sketch are not needed after the first primary frame
+    if (r == 0 && n_frame != 0) {
+        flow.sample_tail.clear();
+    }
+    sp.frame_tail.insert(sp.frame_tail.end(), p_res, p_res + n_frame * n_freq);
+    return torch::from_blob(p_res, {(long) n_frame, (long) n_freq}, torch::kFloat);
+}
+
+
+void AnalyzerWorkerThread::score_flow(FlowState & flow, size_t r, bool flush)
+{
+    const auto n_freq = resolutions[r].n_freq;
+    const auto win_len = p_analyzer_config->mean_win_test;
+    auto & sp = flow.spectrum[r];
+    const size_t n_frame = sp.frame_num(n_freq);
+
+    // the complete windows followed by a frame, which is passed along and kept for the next window,
+    // or all frames when the flow is flushed
+    const size_t n_score = flush ? n_frame : (n_frame == 0 ? 0 : ((n_frame - 1) / win_len) * win_len);
+    if (n_score == 0) {
+        return;
+    }
+
+    const size_t n_pass = flush ? n_score : n_score + 1;
+    const torch::Tensor ten_frame = torch::from_blob(sp.frame_tail.data(), 
+                                                     {(long) n_pass, (long) n_freq}, torch::kFloat);
+    // the models and the result buffer of the owner, in a stolen task as well
+    const auto & view = p_task_owner->views[flow.view];
+    const double_t min_dist = center_distance(ten_frame, view.models[r]);
+    sp.frame_tail.erase(sp.frame_tail.begin(), sp.frame_tail.begin() + n_score * n_freq);
+
+    p_task_owner->record_result(flow.address & prefix_mask(flow.prefix_len), flow.prefix_len, min_dist, 
+                                sp.pending_pkt_num, resolutions[r].n_fft, view.is_destination);
+    sp.pending_pkt_num = 0;
+}
+
+
+void AnalyzerWorkerThread::ship_flow(FlowState & flow, size_t r, bool flush)
+{
+    const auto & res = resolutions[r];
+    auto & sp = flow.spectrum[r];
+    const size_t n_sample = flow.sample_tail.size() - sp.sample_offset;
+    if (n_sample < res.n_fft) {
+        return;
+    }
+
+    // the frames of the complete scoring windows followed by a frame, as in score_flow,
+    // or all frames when the flow is flushed
+    const size_t hop = p_task_owner->frame_hop(r);
+    const size_t n_frame = (n_sample - res.n_fft) / hop + 1;
+    const size_t win_len = p_analyzer_config->mean_win_test;
+    const size_t n_score = flush ? n_frame : ((n_frame - 1) / win_len) * win_len;
+    if (n_score == 0) {
+        return;
+    }
+
+    // the next frame goes along, its samples stay for the next window
+    const size_t n_pass = flush ? n_score : n_score + 1;
+    const auto p_begin = flow.sample_tail.cbegin() + sp.sample_offset;
+    PipelineItem item = {p_task_owner, flow.address & prefix_mask(flow.prefix_len), flow.prefix_len, flow.view, 
+                         (uint8_t) r, sp.pending_pkt_num, n_pass, hop, 
+                         vector<float>(p_begin, p_begin + res.n_fft + (n_pass - 1) * hop)};
+    sp.sample_offset += n_score * hop;
+    sp.pending_pkt_num = 0;
+
+    if (!push_downstream(move(item))) {
+        // back pressure, the window is analyzed here instead of waiting for the stages
+        spectral_stage(item);
+        scoring_stage(item);
+        ++ pipeline_inline_num;
+    }
+}
+
+
+auto AnalyzerWorkerThread::push_downstream(PipelineItem && item) -> bool
+{
+    // round robin over the downstream cores, skipping the full rings
+    for (size_t i = 0; i < out_rings.size(); i ++) {
+        const auto & p_ring = out_rings[out_ring_cursor ++ % out_rings.size()];
+        if (p_ring->push(move(item))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void AnalyzerWorkerThread::spectral_stage(PipelineItem & item)
+{
+    const auto & res = resolutions[item.r];
+    const torch::Tensor ten = torch::from_blob(item.data.data(), {(long) item.data.size()}, torch::kFloat);
+    const torch::Tensor ten_res = spectrum_transform(ten, item.r, item.hop, res.stft_window);
+
+    // the samples are replaced by the frames
+    const auto p_res = ten_res.data_ptr<float>();
+    item.n_frame = ten_res.size(0);
+    item.data.assign(p_res, p_res + item.n_frame * res.n_freq);
+}
+
+
+void AnalyzerWorkerThread::scoring_stage(PipelineItem & item)
+{
+    const auto & res = resolutions[item.r];
+    const torch::Tensor ten_frame = torch::from_blob(item.data.data(), 
+                                                     {(long) item.n_frame, (long) res.n_freq}, torch::kFloat);
+    // the models and the result buffer of the analyzer that grouped the flow
+    const auto & view = item.p_owner->views[item.view];
+    const double_t min_dist = center_distance(ten_frame, view.models[item.r]);
+    item.p_owner->record_result(item.address, item.prefix_len, min_dist, item.pkt_num, res.n_fft, view.is_destination);
+}
+
+
+void AnalyzerWorkerThread::run_stage()
+{
+    const char * stage_name = role == ROLE_SPECTRAL ? "spectral" : "scoring";
+    if (p_analyzer_config->init_verbose) {
+        LOGF("Analyzer on core # %2d: %s stage of the pipeline, %ld upstream rings.", 
+             getCoreId(), stage_name, in_rings.size());
+    }
+
+    PipelineItem item;
+    double_t __s = __get_double_ts();
+    while (!m_stop) {
+        size_t n_item = 0;
+        for (const auto & p_ring : in_rings) {
+            // a bounded burst per ring, so that one upstream core does not starve the others
+            for (size_t i = 0; i < PIPELINE_BURST && p_ring->pop(item); i ++) {
+                if (role == ROLE_SPECTRAL) {
+                    spectral_stage(item);
+                    p_arena->reset();
+                    // the scoring stage never blocks, wait for room
+                    while (!push_downstream(move(item)) && !m_stop) {
+                        this_thread::yield();
+                    }
+                } else {
+                    scoring_stage(item);
+                }
+                ++ n_item;
             }
         }
-#ifdef DETAIL_TIME_ANALYZE
-        sum_dist_time += __get_double_ts() - _s2;
-#endif
+        pipeline_item_num += n_item;
+        if (n_item == 0) {
+            this_thread::yield();
+        }
 
-        if (p_analyzer_config->ip_verbose) {
-            if (p_analyzer_config->verbose_ip_target.length() != 0 && 
-                pcpp::IPv4Address(htonl(iter_mp->first)) == pcpp::IPv4Address(p_analyzer_config->verbose_ip_target)) {
-                LOGF("Analyzer on core # %2d: %6ld abnormal packets, with loss: %6.3lf",
-                getCoreId(),
-                iter_mp->second.size(),
-                min_dist);
+        // queue depth of the upstream rings, the high water shows a stage that can not keep up
+        if (p_analyzer_config->speed_verbose) {
+            const double_t __t = __get_double_ts();
+            if (__t - __s > p_analyzer_config->verbose_interval) {
+                size_t depth = 0, high_water = 0, cap = 0;
+                for (const auto & p_ring : in_rings) {
+                    depth += p_ring->size();
+                    high_water = max(high_water, p_ring->max_size());
+                    cap += p_ring->capacity();
+                }
+                LOGF("Analyzer on core # %2d: %s stage [%ld items, queue depth %ld / %ld, high water %ld]", 
+                     getCoreId(), stage_name, pipeline_item_num, depth, cap, high_water);
+                __s = __t;
             }
         }
+    }
+}
 
-        if (p_analyzer_config->save_to_file) {
-            auto & buf_loc = flow_records[flow_record_size % result_buffer_size];
-            buf_loc = {.address = iter_mp->first,
-                       .distence = min_dist,
-                       .packet_num = iter_mp->second.size()};
-            ++ flow_record_size;
+
+void AnalyzerWorkerThread::record_result(uint32_t address, uint8_t prefix_len, double_t min_dist, 
+                                         size_t pkt_num, size_t n_fft, bool is_destination, 
+                                         record_kind_t kind)
+{
+    if (p_analyzer_config->ip_verbose && prefix_len == 32 && kind == RECORD_SCORE) {
+        if (p_analyzer_config->verbose_ip_target.length() != 0 && 
+            pcpp::IPv4Address(htonl(address)) == pcpp::IPv4Address(p_analyzer_config->verbose_ip_target)) {
+            LOGF("Analyzer on core # %2d: %6ld abnormal packets, with loss: %6.3lf (n_fft %ld, %s)",
+            getCoreId(),
+            pkt_num,
+            min_dist,
+            n_fft,
+            is_destination ? "destination" : "source");
         }
     }
+
+    if (p_analyzer_config->save_to_file) {
+        // stolen tasks of other cores record here as well
+        lock_guard<mutex> guard(record_lock);
+        auto & buf_loc = flow_records[flow_record_size % result_buffer_size];
+        buf_loc = {.address = address,
+                   .distence = min_dist,
+                   .packet_num = pkt_num,
+                   .prefix_len = prefix_len,
+                   .n_fft = (uint32_t) n_fft,
+                   .is_destination = is_destination,
+                   .kind = kind};
+        ++ flow_record_size;
+    }
 }
 
 
-// 2020.12.8
-auto inline AnalyzerWorkerThread::weight_transform(const PacketMetaData & info) -> double_t 
+void AnalyzerWorkerThread::feed_learner(const torch::Tensor & ten_res, size_t r, size_t v)
 {
-     return info.pkt_length * 10 + info.proto_code / 10 + -log2(info.time_stamp) * 15.68;
+    auto & res = views[v].models[r];
+    const auto & p_learner = res.p_learner;
+
+    // feed data to learner
+    torch::Tensor ten_temp;
+    if (ten_res.size(0) > p_analyzer_config->mean_win_train + 1 && !p_learner->reach_learn()) {
+        vector<vector<double_t> > data_to_add;
+        for (size_t i = 0; i < p_analyzer_config->num_train_sample; i ++) {
+            size_t start_index = rand() % (ten_res.size(0) - 1 - p_analyzer_config->mean_win_train);
+            ten_temp = ten_res.slice(0, start_index, start_index + p_analyzer_config->mean_win_train).mean(0);
+            vector<double_t> _dt;
+            for(size_t j = 0; j < ten_temp.size(0); j ++) {
+                _dt.push_back((double_t) ten_temp[j].item<double_t>());
+            }
+            data_to_add.push_back(_dt);
+        }
+
+        p_learner->acquire_semaphore_data();
+        p_learner->add_train_data(data_to_add);
+        p_learner->release_semaphore_data();
+
+    } else {
+        ten_temp =  ten_res.mean(0);
+        vector<double_t> data_to_add;
+        for(size_t j = 0; j < ten_temp.size(0); j ++) {
+            data_to_add.push_back((double_t) ten_temp[j].item<double_t>());
+        }
+        
+        p_learner->acquire_semaphore_data();
+        p_learner->add_train_data(data_to_add);
+        p_learner->release_semaphore_data();
+
+    }
+    
+    // can start train, but none start train
+    p_learner->acquire_semaphore_learn();
+    if (p_learner->reach_learn() && !p_learner->start_learn) {
+        if (p_analyzer_config->mode_verbose) {
+            LOGF("Analyer on core %2d: trigger the training of learner (n_fft %ld, %s view).", getCoreId(), 
+            resolutions[r].n_fft, views[v].is_destination ? "destination" : "source");
+        }
+        p_learner->start_train();
+        p_learner->release_semaphore_learn();
+    } else {
+        p_learner->release_semaphore_learn();
+    }
+
+    // train of this model is finished, but still train
+    if (p_learner->finish_learn && res.is_train) {
+        res.is_train = false;
+
+        // copy training results from learner (clustering centers)
+        const auto & train_res = p_learner->train_result;
+        for (size_t i = 0; i < train_res.size(); i ++) {
+            for (size_t j = 0; j < train_res[0].size(); j ++) {
+                res.centers[i][j] = train_res[i][j];
+            }
+        }
+        // cache the squared norms of the centers for distance calculation
+        res.center_norms = (res.centers * res.centers).sum(1).contiguous();
+
+        if(getCoreId() == p_analyzer_config->verbose_center_core && 
+            p_analyzer_config->center_verbose) {
+            for (size_t i = 0; i < res.centers.size(0); i ++) {
+                cout << res.centers[i] << endl;
+            }
+        }
+    }
+
+    // all models of all views are trained
+    const bool all_trained = all_of(views.cbegin(), views.cend(), [] (const FlowView & _v) -> bool {
+        return none_of(_v.models.cbegin(), _v.models.cend(), 
+                       [] (const ClusterModel & _m) -> bool { return _m.is_train; });
+    });
+    if (all_trained && m_is_train) {
+        m_is_train = false;
+        analysis_start_time = __get_double_ts();
+
+        // clear the counter
+        analysis_pkt_len = 0;
+        analysis_pkt_num = 0;
+
+        if(p_analyzer_config->mode_verbose) {
+            LOGF("Analyer on core %2d: enter execution mode.", getCoreId());
+        }
+    }
 }
 
 
@@ -392,6 +1690,10 @@ auto AnalyzerWorkerThread::get_overall_performance() const -> pair<double_t, dou
 		WARN("Parsing not finish, do not collect result.");
 		return {0, 0};
 	}
+    // the packets are counted by the analyzers in front of the pipeline
+    if (role != ROLE_FULL) {
+        return {0, 0};
+    }
 	return {
         (((double_t) sum_analysis_pkt_num) /  (analysis_end_time - analysis_start_time)) / 1e6, 
         ((((double_t) sum_analysis_pkt_len) * 8.0) /  (analysis_end_time - analysis_start_time)) / 1e9
@@ -417,11 +1719,121 @@ auto AnalyzerWorkerThread::save_res_json() const -> bool
         _j.push_back(flow_records[i].address);
         _j.push_back(flow_records[i].distence);
         _j.push_back(flow_records[i].packet_num);
+        _j.push_back(flow_records[i].prefix_len);
+        _j.push_back(flow_records[i].n_fft);
+        _j.push_back(flow_records[i].is_destination);
+        _j.push_back(flow_records[i].kind);
         j_array.push_back(_j);
     }
 
     json j_res;
     j_res["Results"] = j_array;
+
+    size_t aggregate_num = 0;
+    for (const auto & view : views) {
+        aggregate_num += view.p_aggregate_table->size();
+    }
+    j_res["Flood"] = {
+        {"overflow_pkt_num", sum_overflow_pkt_num + overflow_pkt_num},
+        {"fold_pkt_num", sum_fold_pkt_num + fold_pkt_num},
+        {"aggregate_num", aggregate_num}
+    };
+
+    if (p_analyzer_config->cascade_gate) {
+        j_res["Cascade"] = {
+            {"gate_pkt_num", sum_cascade_gate_pkt_num + cascade_counter.gate_pkt_num},
+            {"fft_pkt_num", sum_cascade_fft_pkt_num + cascade_counter.fft_pkt_num}
+        };
+    }
+
+    if (p_analyzer_config->work_steal) {
+        j_res["WorkSteal"] = {
+            {"task_num", steal_counter.task_num},
+            {"stolen_num", steal_counter.stolen_num.load()},
+            {"steal_num", steal_counter.steal_num}
+        };
+    }
+
+    if (p_merge_tree != nullptr) {
+        j_res["TimeMerge"] = {
+            {"reorder_pkt_num", sum_reorder_pkt_num + reorder_pkt_num}
+        };
+    }
+
+    if (!out_rings.empty()) {
+        j_res["Pipeline"] = {
+            {"inline_num", pipeline_inline_num}
+        };
+    }
+
+    if (p_analyzer_config->latency_target > 0) {
+        j_res["Batching"] = {
+            {"max_fetch", max_fetch},
+            {"wait_time", wait_time},
+            {"pkt_cost", batch_ctrl.pkt_cost},
+            {"batch_num", batch_ctrl.batch_num},
+            {"over_target_num", batch_ctrl.over_target_num},
+            {"max_batch_time", batch_ctrl.max_batch_time}
+        };
+    }
+
+    if (p_analyzer_config->load_shedding) {
+        // the time at each level, the current one up to now
+        json j_level = json::object();
+        for (uint8_t l = SHED_NONE; l < SHED_LEVEL_NUM; l ++) {
+            double_t t = shed_ctrl.level_time[l];
+            if (l == shed_level.load() && shed_ctrl.level_since > 0) {
+                t += __get_double_ts() - shed_ctrl.level_since;
+            }
+            j_level[shed_level_name[l]] = t;
+        }
+        j_res["LoadShedding"] = {
+            {"level", shed_level.load()},
+            {"max_level", shed_ctrl.max_level},
+            {"level_change_num", shed_ctrl.level_change_num},
+            {"level_time", j_level},
+            {"sample_pkt_num", shed_ctrl.sample_pkt_num},
+            {"skip_pkt_num", shed_ctrl.skip_pkt_num},
+            {"prefix_pkt_num", shed_ctrl.prefix_pkt_num}
+        };
+    }
+
+    if (p_heavy_hitter != nullptr) {
+        json j_hh = json::array();
+        for (const auto & c : heavy_hitter_list) {
+            j_hh.push_back({c.key, c.count, c.error});
+        }
+        j_res["HeavyHitter"] = {
+            {"top", j_hh},
+            {"skip_pkt_num", heavy_hitter_skip_pkt_num}
+        };
+    }
+
+    // the statistics of the destination view are tagged, the source view keeps the plain names
+    for (const auto & view : views) {
+        const string view_tag = view.is_destination ? "Destination" : "";
+        if (view.p_low_rate_sketch != nullptr) {
+            const auto & p_sketch = view.p_low_rate_sketch;
+            j_res["LowRate" + view_tag] = {
+                {"bucket_num", p_sketch->bucket_num()},
+                {"fold_num", p_sketch->fold_num},
+                {"series_num", p_sketch->series_num}
+            };
+        }
+
+        const auto & p_table = view.p_flow_table;
+        const auto & _st = p_table->stat;
+        j_res["FlowTable" + view_tag] = {
+            {"flow_num", p_table->size()},
+            {"memory_size", p_table->memory_size()},
+            {"max_flow_num", _st.max_flow_num},
+            {"max_memory_size", _st.max_mem_size},
+            {"evict_idle_num", _st.evict_idle_num},
+            {"evict_flow_cap_num", _st.evict_flow_cap_num},
+            {"evict_memory_cap_num", _st.evict_mem_cap_num},
+            {"finalize_num", _st.finalize_num}
+        };
+    }
     ofstream of(file_name);
     if (of) {
         of << j_res;
@@ -452,8 +1864,244 @@ auto AnalyzerWorkerThread::configure_via_json(const json & jin) -> bool
 
         // parameters for frequency domain representations
         if (jin.count("n_fft")) {
-            p_analyzer_config->n_fft = 
-                static_cast<decltype(p_analyzer_config->n_fft)>(jin["n_fft"]);
+            // a list of FFT sizes, the first one is the primary resolution
+            if (jin["n_fft"].is_array()) {
+                if (jin["n_fft"].empty()) {
+                    WARNF("Empty n_fft list.");
+                    throw logic_error("Parse error Json tag: n_fft\n");
+                }
+                p_analyzer_config->n_fft_list = 
+                    jin["n_fft"].get<decltype(p_analyzer_config->n_fft_list)>();
+                p_analyzer_config->n_fft = p_analyzer_config->n_fft_list[0];
+            } else {
+                p_analyzer_config->n_fft = 
+                    static_cast<decltype(p_analyzer_config->n_fft)>(jin["n_fft"]);
+                p_analyzer_config->n_fft_list = {p_analyzer_config->n_fft};
+            }
+        }
+
+        if (jin.count("kernel_isa")) {
+            p_analyzer_config->kernel_isa = 
+                static_cast<decltype(p_analyzer_config->kernel_isa)>(jin["kernel_isa"]);
+            if (find(spectral_kernel_isa_list.cbegin(), spectral_kernel_isa_list.cend(), 
+                     p_analyzer_config->kernel_isa) == spectral_kernel_isa_list.cend()) {
+                WARNF("Unknown kernel instruction set: %s", p_analyzer_config->kernel_isa.c_str());
+                throw logic_error("Parse error Json tag: kernel_isa\n");
+            }
+        }
+
+        // analysis cost profile
+        if (jin.count("analysis_profile")) {
+            p_analyzer_config->analysis_profile = 
+                static_cast<decltype(p_analyzer_config->analysis_profile)>(jin["analysis_profile"]);
+            if (analysis_profile_map.count(p_analyzer_config->analysis_profile) == 0) {
+                WARNF("Unknown analysis profile: %s", p_analyzer_config->analysis_profile.c_str());
+                throw logic_error("Parse error Json tag: analysis_profile\n");
+            }
+        }
+        if (jin.count("stft_hop")) {
+            p_analyzer_config->stft_hop = 
+                static_cast<decltype(p_analyzer_config->stft_hop)>(jin["stft_hop"]);
+        }
+        if (p_analyzer_config->stft_hop == 0) {
+            p_analyzer_config->stft_hop = p_analyzer_config->n_fft / 
+                    analysis_profile_map.at(p_analyzer_config->analysis_profile);
+        }
+        if (p_analyzer_config->stft_hop == 0 || p_analyzer_config->stft_hop > p_analyzer_config->n_fft) {
+            WARNF("Invalid STFT hop length.");
+            throw logic_error("Parse error Json tag: stft_hop\n");
+        }
+        // every resolution builds its own learners, and needs a reference hop of the accurate profile
+        for (size_t r = 0; r < p_analyzer_config->n_fft_list.size(); r ++) {
+            const auto n_fft = p_analyzer_config->n_fft_list[r];
+            if (n_fft < analysis_profile_map.at("accurate")) {
+                WARNF("FFT size %ld too small for the reference hop.", n_fft);
+                throw logic_error("Parse error Json tag: n_fft\n");
+            }
+            if (find(p_analyzer_config->n_fft_list.cbegin(), p_analyzer_config->n_fft_list.cbegin() + r,
+                     n_fft) != p_analyzer_config->n_fft_list.cbegin() + r) {
+                WARNF("Duplicated FFT size %ld.", n_fft);
+                throw logic_error("Parse error Json tag: n_fft\n");
+            }
+            const size_t hop = r == 0 ? p_analyzer_config->stft_hop :
+                               n_fft / analysis_profile_map.at(p_analyzer_config->analysis_profile);
+            if (hop == 0 || hop > n_fft) {
+                WARNF("Invalid STFT hop length %ld of FFT size %ld.", hop, n_fft);
+                throw logic_error("Parse error Json tag: n_fft\n");
+            }
+        }
+        if (jin.count("stft_window")) {
+            p_analyzer_config->stft_window = 
+                static_cast<decltype(p_analyzer_config->stft_window)>(jin["stft_window"]);
+            if (find(stft_window_list.cbegin(), stft_window_list.cend(), 
+                     p_analyzer_config->stft_window) == stft_window_list.cend()) {
+                WARNF("Unknown STFT window: %s", p_analyzer_config->stft_window.c_str());
+                throw logic_error("Parse error Json tag: stft_window\n");
+            }
+        }
+        if (jin.count("wait_mode")) {
+            p_analyzer_config->wait_mode = 
+                static_cast<decltype(p_analyzer_config->wait_mode)>(jin["wait_mode"]);
+            if (find(wait_mode_list.cbegin(), wait_mode_list.cend(), 
+                     p_analyzer_config->wait_mode) == wait_mode_list.cend()) {
+                WARNF("Unknown wait mode: %s", p_analyzer_config->wait_mode.c_str());
+                throw logic_error("Parse error Json tag: wait_mode\n");
+            }
+        }
+        if (jin.count("latency_target")) {
+            p_analyzer_config->latency_target = 
+                static_cast<decltype(p_analyzer_config->latency_target)>(jin["latency_target"]);
+            if (p_analyzer_config->latency_target < 0) {
+                WARNF("Invalid batch latency target.");
+                throw logic_error("Parse error Json tag: latency_target\n");
+            }
+        }
+        if (jin.count("work_steal")) {
+            p_analyzer_config->work_steal = 
+                static_cast<decltype(p_analyzer_config->work_steal)>(jin["work_steal"]);
+        }
+        if (jin.count("load_shedding")) {
+            p_analyzer_config->load_shedding = 
+                static_cast<decltype(p_analyzer_config->load_shedding)>(jin["load_shedding"]);
+        }
+        if (jin.count("shed_up_backlog")) {
+            p_analyzer_config->shed_up_backlog = 
+                static_cast<decltype(p_analyzer_config->shed_up_backlog)>(jin["shed_up_backlog"]);
+        }
+        if (jin.count("shed_down_backlog")) {
+            p_analyzer_config->shed_down_backlog = 
+                static_cast<decltype(p_analyzer_config->shed_down_backlog)>(jin["shed_down_backlog"]);
+        }
+        if (p_analyzer_config->shed_down_backlog < 0 || 
+            p_analyzer_config->shed_down_backlog >= p_analyzer_config->shed_up_backlog) {
+            WARNF("Invalid load shedding backlog: [up %4.2lf, down %4.2lf]", 
+                  p_analyzer_config->shed_up_backlog, p_analyzer_config->shed_down_backlog);
+            throw logic_error("Parse error Json tag: shed_down_backlog\n");
+        }
+        if (jin.count("shed_latency")) {
+            p_analyzer_config->shed_latency = 
+                static_cast<decltype(p_analyzer_config->shed_latency)>(jin["shed_latency"]);
+            if (p_analyzer_config->shed_latency <= 0) {
+                WARNF("Invalid load shedding latency.");
+                throw logic_error("Parse error Json tag: shed_latency\n");
+            }
+        }
+        if (jin.count("shed_sample_ratio")) {
+            p_analyzer_config->shed_sample_ratio = 
+                static_cast<decltype(p_analyzer_config->shed_sample_ratio)>(jin["shed_sample_ratio"]);
+            if (p_analyzer_config->shed_sample_ratio <= 0 || p_analyzer_config->shed_sample_ratio > 1) {
+                WARNF("Invalid load shedding sampling ratio.");
+                throw logic_error("Parse error Json tag: shed_sample_ratio\n");
+            }
+        }
+        if (jin.count("shed_hold_time")) {
+            p_analyzer_config->shed_hold_time = 
+                static_cast<decltype(p_analyzer_config->shed_hold_time)>(jin["shed_hold_time"]);
+            if (p_analyzer_config->shed_hold_time < 0) {
+                WARNF("Invalid load shedding hold time.");
+                throw logic_error("Parse error Json tag: shed_hold_time\n");
+            }
+        }
+        if (jin.count("spectrum_mode")) {
+            p_analyzer_config->spectrum_mode = 
+                static_cast<decltype(p_analyzer_config->spectrum_mode)>(jin["spectrum_mode"]);
+            if (p_analyzer_config->spectrum_mode != "stft" && p_analyzer_config->spectrum_mode != "sliding") {
+                WARNF("Unknown spectrum mode: %s", p_analyzer_config->spectrum_mode.c_str());
+                throw logic_error("Parse error Json tag: spectrum_mode\n");
+            }
+        }
+        if (jin.count("analysis_view")) {
+            p_analyzer_config->analysis_view = 
+                static_cast<decltype(p_analyzer_config->analysis_view)>(jin["analysis_view"]);
+            if (analysis_view_map.find(p_analyzer_config->analysis_view) == analysis_view_map.end()) {
+                WARNF("Unknown analysis view: %s", p_analyzer_config->analysis_view.c_str());
+                throw logic_error("Parse error Json tag: analysis_view\n");
+            }
+        }
+        if (jin.count("profile_drift_sample")) {
+            p_analyzer_config->profile_drift_sample = 
+                static_cast<decltype(p_analyzer_config->profile_drift_sample)>(jin["profile_drift_sample"]);
+            if (p_analyzer_config->profile_drift_sample < 0 || p_analyzer_config->profile_drift_sample > 1) {
+                WARNF("Invalid drift sampling ratio.");
+                throw logic_error("Parse error Json tag: profile_drift_sample\n");
+            }
+        }
+
+        if (jin.count("epoch_time")) {
+            p_analyzer_config->epoch_time = 
+                static_cast<decltype(p_analyzer_config->epoch_time)>(jin["epoch_time"]);
+            if (p_analyzer_config->epoch_time < 0) {
+                WARNF("Invalid analysis epoch time.");
+                throw logic_error("Parse error Json tag: epoch_time\n");
+            }
+        }
+        if (jin.count("flush_idle_time")) {
+            p_analyzer_config->flush_idle_time = 
+                static_cast<decltype(p_analyzer_config->flush_idle_time)>(jin["flush_idle_time"]);
+            if (p_analyzer_config->flush_idle_time < 0) {
+                WARNF("Invalid flow flush time.");
+                throw logic_error("Parse error Json tag: flush_idle_time\n");
+            }
+        }
+
+        // flow table budget
+        if (jin.count("max_flow_num")) {
+            p_analyzer_config->max_flow_num = 
+                static_cast<decltype(p_analyzer_config->max_flow_num)>(jin["max_flow_num"]);
+        }
+        if (jin.count("max_flow_mem")) {
+            p_analyzer_config->max_flow_mem = 
+                static_cast<decltype(p_analyzer_config->max_flow_mem)>(jin["max_flow_mem"]);
+        }
+        if (jin.count("finalize_min_pkt")) {
+            p_analyzer_config->finalize_min_pkt = 
+                static_cast<decltype(p_analyzer_config->finalize_min_pkt)>(jin["finalize_min_pkt"]);
+        }
+
+        if (jin.count("aggregate_prefix_len")) {
+            p_analyzer_config->aggregate_prefix_len = 
+                static_cast<decltype(p_analyzer_config->aggregate_prefix_len)>(jin["aggregate_prefix_len"]);
+            if (p_analyzer_config->aggregate_prefix_len < 8 || p_analyzer_config->aggregate_prefix_len > 24) {
+                WARNF("Invalid aggregate prefix length, expect 8 - 24.");
+                throw logic_error("Parse error Json tag: aggregate_prefix_len\n");
+            }
+        }
+        if (jin.count("max_aggregate_num")) {
+            p_analyzer_config->max_aggregate_num = 
+                static_cast<decltype(p_analyzer_config->max_aggregate_num)>(jin["max_aggregate_num"]);
+        }
+
+        if (jin.count("cascade_gate")) {
+            p_analyzer_config->cascade_gate = 
+                static_cast<decltype(p_analyzer_config->cascade_gate)>(jin["cascade_gate"]);
+        }
+        if (jin.count("cascade_sample")) {
+            p_analyzer_config->cascade_sample = 
+                static_cast<decltype(p_analyzer_config->cascade_sample)>(jin["cascade_sample"]);
+            if (p_analyzer_config->cascade_sample < 0 || p_analyzer_config->cascade_sample > 1) {
+                WARNF("Invalid first stage sampling ratio.");
+                throw logic_error("Parse error Json tag: cascade_sample\n");
+            }
+        }
+        if (jin.count("cascade_bound_z")) {
+            p_analyzer_config->cascade_bound_z = 
+                static_cast<decltype(p_analyzer_config->cascade_bound_z)>(jin["cascade_bound_z"]);
+            if (p_analyzer_config->cascade_bound_z <= 0) {
+                WARNF("Invalid first stage bound.");
+                throw logic_error("Parse error Json tag: cascade_bound_z\n");
+            }
+        }
+        if (jin.count("heavy_hitter_k")) {
+            p_analyzer_config->heavy_hitter_k = 
+                static_cast<decltype(p_analyzer_config->heavy_hitter_k)>(jin["heavy_hitter_k"]);
+        }
+        if (jin.count("heavy_hitter_restrict")) {
+            p_analyzer_config->heavy_hitter_restrict = 
+                static_cast<decltype(p_analyzer_config->heavy_hitter_restrict)>(jin["heavy_hitter_restrict"]);
+        }
+        if (jin.count("low_rate_bucket_num")) {
+            p_analyzer_config->low_rate_bucket_num = 
+                static_cast<decltype(p_analyzer_config->low_rate_bucket_num)>(jin["low_rate_bucket_num"]);
         }
 
         // machine learning
@@ -469,6 +2117,14 @@ auto AnalyzerWorkerThread::configure_via_json(const json & jin) -> bool
             p_analyzer_config->num_train_sample = 
                 static_cast<decltype(p_analyzer_config->num_train_sample)>(jin["num_train_sample"]);
         }
+        if (jin.count("alert_distance")) {
+            p_analyzer_config->alert_distance = 
+                static_cast<decltype(p_analyzer_config->alert_distance)>(jin["alert_distance"]);
+            if (p_analyzer_config->alert_distance < 0) {
+                WARNF("Invalid alert distance.");
+                throw logic_error("Parse error Json tag: alert_distance\n");
+            }
+        }
 
         // verbose parameters
         if (jin.count("mode_verbose")) {
@@ -495,6 +2151,14 @@ auto AnalyzerWorkerThread::configure_via_json(const json & jin) -> bool
             p_analyzer_config->speed_verbose = 
                 static_cast<decltype(p_analyzer_config->speed_verbose)>(jin["speed_verbose"]);
         }
+        if (jin.count("arena_verbose")) {
+            p_analyzer_config->arena_verbose = 
+                static_cast<decltype(p_analyzer_config->arena_verbose)>(jin["arena_verbose"]);
+        }
+        if (jin.count("flow_verbose")) {
+            p_analyzer_config->flow_verbose = 
+                static_cast<decltype(p_analyzer_config->flow_verbose)>(jin["flow_verbose"]);
+        }
         if (jin.count("verbose_interval")) {
             p_analyzer_config->verbose_interval = 
                 static_cast<decltype(p_analyzer_config->verbose_interval)>(jin["verbose_interval"]);
@@ -550,6 +2214,13 @@ auto AnalyzerWorkerThread::configure_via_json(const json & jin) -> bool
         } else {
             WARNF("Critical tag not found: meta_pkt_arr_size, use default.");
         }
+        if (jin.count("arena_size")) {
+            arena_size = 
+                static_cast<decltype(arena_size)>(jin["arena_size"]);
+            if (arena_size > MAX_ARENA_SIZE) {
+                FATAL_ERROR("Batch arena size exceed.");
+            }
+        }
         if (jin.count("result_buffer_size")) {
             result_buffer_size = 
                 static_cast<decltype(result_buffer_size)>(jin["result_buffer_size"]);
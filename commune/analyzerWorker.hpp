@@ -4,10 +4,25 @@
 #include "dpdkCommon.hpp"
 #include "parserWorker.hpp"
 #include "kMeansLearner.hpp"
+#include "spectralKernel.hpp"
+#include "batchArena.hpp"
+#include "flowTable.hpp"
+#include "timerWheel.hpp"
+#include "lowRateSketch.hpp"
+#include "spaceSaving.hpp"
+#include "flowCascade.hpp"
+#include "workStealing.hpp"
+#include "spscRing.hpp"
+#include "loserTree.hpp"
+#include "localBuffer.hpp"
 
 
 #include <torch/torch.h>
 
+#include <atomic>
+#include <mutex>
+#include <random>
+
 
 namespace Whisper
 {
@@ -15,21 +30,107 @@ namespace Whisper
 
 struct PacketMetaData;
 class ParserWorkerThread;
+struct ParserLane;
 class KMeansLearner;
 class DeviceConfig;
 
 
+// Overlap factor of each analysis profile, i.e. STFT hop = n_fft / factor
+static const map<string, size_t> analysis_profile_map = {
+    {"accurate", 4},
+    {"balanced", 2},
+    {"fast", 1}
+};
+
+static const vector<string> stft_window_list = {"rect", "hann", "hamming"};
+
+// Wait of the analyzer between batches: fixed sleep, eventfd wakeup with timeout, or busy polling
+static const vector<string> wait_mode_list = {"sleep", "event", "busy"};
+
+// Names of the load shedding levels, in the order they are applied
+static const char * const shed_level_name[] = {"none", "sampling", "coarse hop", "skip low priority", "prefix only"};
+
+// Views of each analysis mode, true for the grouping by destination address
+static const map<string, vector<bool> > analysis_view_map = {
+    {"source", {false}},
+    {"destination", {true}},
+    {"both", {false, true}}
+};
+
+
 struct AnalyzerConfigParam final {
 
-    // Number of fft
+    // Number of fft, the primary (first) resolution
     size_t n_fft = 50;
+    // All FFT sizes analyzed in one pass, each with its own clustering centers
+    vector<size_t> n_fft_list = {50};
+    // Instruction set of analysis kernels: auto, scalar, avx2
+    string kernel_isa = "auto";
+
+    // Analysis cost profile, the overlap of STFT frames: accurate, balanced, fast
+    string analysis_profile = "accurate";
+    // STFT hop length of the primary resolution, 0 for the one of analysis profile
+    size_t stft_hop = 0;
+    // STFT window function: rect, hann, hamming
+    string stft_window = "rect";
+    // Spectrum of flows: stft (per batch), sliding (incremental DFT per packet)
+    string spectrum_mode = "stft";
+    // Grouping of packets into flows: source, destination, both (in the same batch pass, each with its own models)
+    string analysis_view = "source";
+    // Fraction of flows also analyzed by the accurate profile to measure the score drift
+    double_t profile_drift_sample = 0;
 
     // Mean Window Train
     size_t mean_win_train = 50;
     // Mean Window Test
     size_t mean_win_test = 100;
+    // Score each flow at the end of fixed time epochs of this length (s), 0 for batch driven analysis
+    double_t epoch_time = 0;
+    // Finalize and evict a flow idle for this time (s)
+    double_t flush_idle_time = 1.0;
+    // Budget of the flow table of each analyzer, LRU flows are evicted beyond it (0 for unlimited)
+    size_t max_flow_num = 1 << 20;
+    size_t max_flow_mem = 1ul << 30;
+    // Evicted flows shorter than this (packets) are dropped without a score
+    size_t finalize_min_pkt = 50;
+    // New sources beyond max_flow_num are analyzed per prefix of this length,
+    // and per /8 beyond max_aggregate_num prefixes
+    uint8_t aggregate_prefix_len = 24;
+    size_t max_aggregate_num = 1 << 16;
+    // Buckets of the aggregate series of flows too short for one frame, 0 to drop them
+    size_t low_rate_bucket_num = 4096;
+    // Number of heavy-hitter addresses of the first view tracked per epoch and analyzed first, 0 to disable
+    size_t heavy_hitter_k = 64;
+    // Analyze the heavy hitters only in the first view (and the prefix aggregates)
+    bool heavy_hitter_restrict = false;
+    // First stage before the frequency domain analysis: only the flows out of the learned
+    // bounds (mean +- cascade_bound_z std), and a cascade_sample fraction of the rest, pass
+    bool cascade_gate = false;
+    double_t cascade_sample = 0.05;
+    double_t cascade_bound_z = 3.0;
+    // Wait for the parsers: sleep (pause_time), event (parser wakeup, pause_time as timeout),
+    // busy (poll without sleeping, for dedicated cores)
+    string wait_mode = "event";
+    // Latency target of a batch (s), from the wait to the end of its analysis. The fetch size and the
+    // wait time follow the measured analysis cost toward it, 0 for the fixed max_fetch and pause_time
+    double_t latency_target = 0;
+    // Flows of a batch are tasks that idle analyzers steal, in execution mode
+    bool work_steal = false;
+    // Shed load in levels while the analyzer falls behind, in execution mode: sampling of the sources
+    // (shed_sample_ratio kept), STFT hop of the fast profile, no low priority flow, prefix-only aggregation.
+    // A level is added when the buffered share of the lanes exceeds shed_up_backlog or a batch exceeds
+    // shed_latency (s), at most every quarter of shed_hold_time, and removed after shed_hold_time (s)
+    // under shed_down_backlog and half of shed_latency
+    bool load_shedding = false;
+    double_t shed_up_backlog = 0.5;
+    double_t shed_down_backlog = 0.1;
+    double_t shed_latency = 0.5;
+    double_t shed_sample_ratio = 0.5;
+    double_t shed_hold_time = 5.0;
     // Number of train sampling
     size_t num_train_sample = 50;
+    // Stop scoring a flow once a window exceeds this distance (0 for full scoring)
+    double_t alert_distance = 0;
 
     // Save results to file
     bool save_to_file = false;
@@ -45,6 +146,8 @@ struct AnalyzerConfigParam final {
     bool center_verbose = false;
     bool speed_verbose = false;
     bool ip_verbose = false;
+    bool arena_verbose = false;
+    bool flow_verbose = false;
     string verbose_ip_target = "";
     cpu_core_id_t verbose_center_core = 10;
 
@@ -55,9 +158,41 @@ struct AnalyzerConfigParam final {
         printf("ML realated param:\n");
         printf("Traing window size: %ld, Testing window size: %ld, Num. Training sample: %ld\n",
         mean_win_train, mean_win_test, num_train_sample);
+        if (epoch_time > 0) {
+            printf("Analysis epoch: %4.2lfs\n", epoch_time);
+        }
+        printf("Flow idle time: %4.2lfs, Max. flows: %ld, Max. flow memory: %ld bytes, Min. finalized packets: %ld\n", 
+        flush_idle_time, max_flow_num, max_flow_mem, finalize_min_pkt);
+        printf("Overflow aggregate prefix: /%d, Max. prefixes: %ld, Low-rate buckets: %ld\n", 
+        (int) aggregate_prefix_len, max_aggregate_num, low_rate_bucket_num);
+        if (cascade_gate) {
+            printf("First stage gate: bound %4.2lf std, sampling %4.2lf\n", cascade_bound_z, cascade_sample);
+        }
+        if (heavy_hitter_k != 0) {
+            printf("Heavy hitters: top %ld%s\n", heavy_hitter_k, heavy_hitter_restrict ? " (restricted)" : "");
+        }
+        if (alert_distance > 0) {
+            printf("Early exit alert distance: %4.2lf\n", alert_distance);
+        }
+        printf("Wait mode: %s%s", wait_mode.c_str(), work_steal ? ", Work stealing" : "");
+        if (latency_target > 0) {
+            printf(", Batch latency target: %4.3lfs", latency_target);
+        }
+        printf("\n");
+        if (load_shedding) {
+            printf("Load shedding: backlog [up %4.2lf, down %4.2lf], batch latency %4.3lfs, sampling %4.2lf, hold %4.2lfs\n",
+            shed_up_backlog, shed_down_backlog, shed_latency, shed_sample_ratio, shed_hold_time);
+        }
 
         printf("Frequency domain analysis realated param:\n");
-        printf("FFT component size: %ld\n", n_fft);
+        stringstream ss_fft;
+        for (size_t i = 0; i < n_fft_list.size(); i ++) {
+            ss_fft << (i == 0 ? "" : ", ") << n_fft_list[i];
+        }
+        printf("FFT component size: [%s], Kernel instruction set: %s\n", ss_fft.str().c_str(), kernel_isa.c_str());
+        printf("Analysis profile: %s, Spectrum mode: %s, STFT hop: %ld, STFT window: %s, Drift sampling: %4.2lf\n", 
+        analysis_profile.c_str(), spectrum_mode.c_str(), stft_hop, stft_window.c_str(), profile_drift_sample);
+        printf("Analysis view: %s\n", analysis_view.c_str());
 
         if (save_to_file) {
             printf("Saving related param:\n");
@@ -71,6 +206,8 @@ struct AnalyzerConfigParam final {
         if (mode_verbose) ss << "Mode,";
         if (center_verbose) ss << "Center,";
         if (speed_verbose) ss << "Speed,";
+        if (arena_verbose) ss << "Arena,";
+        if (flow_verbose) ss << "Flow,";
         if (ip_verbose) ss << "IP: " << verbose_ip_target;
         ss << "}";
         printf("%s (Interval %4.2lfs)\n\n", ss.str().c_str(), verbose_interval);
@@ -100,8 +237,20 @@ private:
 
     // Index of per-packet properties array copied form Analyzer
     mutable size_t m_index = 0;
-    // pause time for waitting analyzer (us)
+    // pause time for waitting analyzer (us), the timeout of a wait in event mode
     size_t pause_time = 50000;
+    // Eventfd signalled by the bound parsers, and by the peers publishing tasks
+    int wakeup_fd = -1;
+    void inline signal_wakeup() const {
+        const uint64_t one = 1;
+        if (wakeup_fd >= 0) {
+            // fails only when the counter saturates, i.e. the analyzer is signalled already
+            const ssize_t ret = write(wakeup_fd, &one, sizeof(one));
+            (void) ret;
+        }
+    }
+    size_t wakeup_event_num = 0;
+    size_t wakeup_timeout_num = 0;
 
 	uint64_t analysis_pkt_len = 0;
 	uint64_t analysis_pkt_num = 0;
@@ -113,10 +262,25 @@ private:
     #define MAX_META_PKT_ARR_SIZE (1 << 25)
     size_t meta_pkt_arr_size = 2000000;
 	shared_ptr<PacketMetaData[]> meta_pkt_arr;
+    // Timestamp merge of the segments fetched from each parser, with more than one parser:
+    // segment bounds in meta_pkt_arr, next packet of each segment, and the merge output swapped in
+    vector<size_t> fetch_bound;
+    vector<size_t> merge_head;
+    shared_ptr<LoserTree<double_t> > p_merge_tree;
+    shared_ptr<PacketMetaData[]> merge_pkt_arr;
+    // Packets moved by the merge
+    size_t reorder_pkt_num = 0;
+    size_t sum_reorder_pkt_num = 0;
 
 // #define DETAIL_TIME_ANALYZE
 // #define __DETAIL_TIME_ANALYZE
 
+// Run the legacy tensor chain beside the fused spectral kernel, compare the time and the result
+// #define SPECTRAL_KERNEL_BENCH
+#if defined(SPECTRAL_KERNEL_BENCH) && !defined(DETAIL_TIME_ANALYZE)
+#define DETAIL_TIME_ANALYZE
+#endif
+
 #ifdef DETAIL_TIME_ANALYZE
     double_t sum_weight_time = 0;
     double_t sum_dist_time = 0;
@@ -127,20 +291,165 @@ private:
 #endif
 #endif
 
-    // The result of train, i.e. the clustring centers
-    torch::Tensor centers;
-    // KMeans Learner
-    shared_ptr<KMeansLearner> p_learner;
-    // The registed ParserWorkers
-    vector<shared_ptr<ParserWorkerThread> > p_parser;
+#ifdef SPECTRAL_KERNEL_BENCH
+    // the transform time includes both paths, the two post-processing steps are timed apart
+    double_t sum_fused_kernel_time = 0;
+    double_t sum_legacy_transform_time = 0;
+    double_t max_fused_kernel_error = 0;
+#endif
+
+    // Analysis kernels selected for this CPU
+    const SpectralKernel * p_kernel = nullptr;
+
+    struct CascadeCounter {
+        size_t decision_num = 0;
+        size_t gate_num = 0;
+        size_t gate_pkt_num = 0;
+        size_t fft_pkt_num = 0;
+        double_t stage_time = 0;
+        double_t fft_time = 0;
+    };
+    CascadeCounter cascade_counter;
+    // Sampling of the usual flows, drawn by the thread running the flow
+    mt19937 gate_rng{random_device{}()};
+    uniform_real_distribution<double_t> gate_dist{0, 1};
+    size_t sum_cascade_gate_pkt_num = 0;
+    size_t sum_cascade_fft_pkt_num = 0;
+
+    // Space-Saving summary of the addresses of the first view, decayed at each epoch
+    shared_ptr<SpaceSaving<uint32_t> > p_heavy_hitter;
+    vector<SpaceSaving<uint32_t>::Counter> heavy_hitter_list;
+    // Sorted heavy-hitter addresses of the last epoch
+    vector<uint32_t> heavy_keys;
+    int64_t heavy_hitter_epoch = -1;
+    size_t heavy_hitter_skip_pkt_num = 0;
+
+    auto inline table_of(const FlowState & flow) -> FlowTable & {
+        auto & view = views[flow.view];
+        return flow.prefix_len == 32 ? *view.p_flow_table : *view.p_aggregate_table;
+    }
+    // Per-batch flow grouping, from the key to the flow index of the batch
+    using batch_map_t = unordered_map<uint64_t, uint32_t, SeededHash, equal_to<uint64_t>, 
+                                      ArenaAllocator<pair<const uint64_t, uint32_t> > >;
+    SeededHash batch_hash;
+
+    // Keys of the batch grouping and the epoch wheel: host address, or tagged prefix, and the view above
+    #define AGGREGATE_KEY_TAG (1ull << 32)
+    #define VIEW_KEY_SHIFT 33
+    auto static inline prefix_mask(uint8_t len) -> uint32_t {
+        return len == 0 ? 0 : ~((uint32_t) 0) << (32 - len);
+    }
+    auto static inline key_of_flow(const FlowState & flow) -> uint64_t {
+        return ((uint64_t) flow.view << VIEW_KEY_SHIFT) | 
+               (flow.prefix_len == 32 ? flow.address : AGGREGATE_KEY_TAG | flow.address);
+    }
+
+    // Packets of new sources beyond the flow table, and those folded to /8 beyond the prefix budget
+    size_t overflow_pkt_num = 0;
+    size_t fold_pkt_num = 0;
+    size_t sum_overflow_pkt_num = 0;
+    size_t sum_fold_pkt_num = 0;
+    // Latest packet time stamp analyzed
+    double_t analysis_clock = 0;
+    // Wall time minus packet time at the last non-empty batch
+    double_t clock_offset = 0;
+
+    // Epoch ends of the flows, one tick per millisecond
+    shared_ptr<HierarchicalTimerWheel<uint64_t> > p_epoch_wheel;
+    auto inline epoch_of(double_t ts) const -> int64_t {
+        return (int64_t) floor(ts / p_analyzer_config->epoch_time);
+    }
+    auto inline epoch_tick(double_t epoch) const -> uint64_t {
+        return (uint64_t) llround(epoch * p_analyzer_config->epoch_time * 1000);
+    }
+
+    // Scratch memory for one call of wave_analyze, reset after each batch
+    #define MAX_ARENA_SIZE (1ul << 32)
+    size_t arena_size = 1 << 26;
+    shared_ptr<BatchArena> p_arena;
+
+    // One spectral resolution of the analysis, with its own clustering model
+    struct Resolution {
+        size_t n_fft;
+        size_t n_freq;
+        // STFT parameters resolved from the analysis profile
+        size_t stft_hop;
+        torch::Tensor stft_window;
+        // STFT hop of the accurate profile, as reference of score drift
+        size_t reference_hop;
+        // STFT hop while the load shedding coarsens the frames
+        size_t shed_hop;
+        // Sliding DFT twiddle factors
+        vector<complex<double_t> > sdft_twiddle;
+    };
+    vector<Resolution> resolutions;
+
+    // Clustering model of one resolution in one view
+    struct ClusterModel {
+        // KMeans Learner
+        shared_ptr<KMeansLearner> p_learner;
+        // The result of train, i.e. the clustring centers
+        torch::Tensor centers;
+        // Squared norms of the clustring centers
+        torch::Tensor center_norms;
+        bool is_train = true;
+    };
+    // Grouping of the packets by one of their addresses, with its own flows and models
+    struct FlowView {
+        bool is_destination;
+        // Flow states kept across batches
+        shared_ptr<FlowTable> p_flow_table;
+        // Flow states of the prefixes not admitted to p_flow_table
+        shared_ptr<FlowTable> p_aggregate_table;
+        // Aggregate series of the short flows, by prefix
+        shared_ptr<LowRateSketch> p_low_rate_sketch;
+        // Learned bounds of the first stage
+        shared_ptr<CascadeModel> p_cascade;
+        // One per resolution
+        vector<ClusterModel> models;
+    };
+    vector<FlowView> views;
+    // KMeans Learners, one per resolution of each view (view major)
+    vector<shared_ptr<KMeansLearner> > p_learner_vec;
+
+    // Sliding DFT window coefficients in frequency domain
+    double_t sdft_window_a0 = 1;
+    double_t sdft_window_a1 = 0;
+    // Score drift against the accurate profile, of the verbose interval and of the whole run
+    double_t sum_profile_drift = 0;
+    double_t max_profile_drift = 0;
+    size_t profile_drift_num = 0;
+    double_t run_sum_profile_drift = 0;
+    double_t run_max_profile_drift = 0;
+    size_t run_profile_drift_num = 0;
+    // Analysis time of the batches, and the part spent on the reference analysis of the drift samples
+    double_t sum_batch_time = 0;
+    double_t profile_drift_time = 0;
+    // The registed lanes of the ParserWorkers
+    vector<shared_ptr<ParserLane> > p_lane;
+    // Parked by the analyzer scaling: its lanes receive no packet, and it waits without polling
+    atomic<bool> is_parked{false};
+    // EWMA of the buffered share of its lanes, measured by the analyzer scaling
+    double_t backlog = 0;
     // configuration
     shared_ptr<AnalyzerConfigParam> p_analyzer_config;
     
+    // Kind of a result: a score, the verdict of the first stage that the flow is usual (no distance),
+    // or the score of a low-rate bucket shared by several prefixes (the address is the bucket index)
+    enum record_kind_t : uint8_t {
+        RECORD_SCORE = 0,
+        RECORD_GATED = 1,
+        RECORD_MIXED = 2
+    };
     // Result signature
     typedef struct {
         uint32_t address;
         double distence;
         size_t packet_num;
+        uint8_t prefix_len;
+        uint32_t n_fft;
+        bool is_destination;
+        record_kind_t kind;
     } FlowRecord;
 
     // Memory to save results
@@ -148,29 +457,205 @@ private:
     size_t result_buffer_size = 500000;
     size_t flow_record_size = 0;
     shared_ptr<FlowRecord[]> flow_records;
-
-    const size_t max_fetch = 1 << 17;
+    mutex record_lock;
+
+    // Analysis of the packets of one flow in a batch, all within the open epoch of the flow
+    struct FlowTask {
+        FlowState * p_flow;
+        const size_t * p_index;
+        size_t n;
+    };
+    WorkStealingDeque<FlowTask> task_deque;
+    // Tasks of the current batch not finished yet, by this analyzer or by thieves
+    atomic<size_t> pending_task_num{0};
+    // The other analyzers, to steal from
+    vector<AnalyzerWorkerThread *> peers;
+    // Owner of the flow under analysis: its batch, models and result buffer. This analyzer except in a stolen task
+    AnalyzerWorkerThread * p_task_owner = this;
+    struct StealCounter {
+        // Own tasks, those run by other analyzers, and the tasks of others run here
+        size_t task_num = 0;
+        atomic<size_t> stolen_num{0};
+        size_t steal_num = 0;
+        // Time analyzing, own batches and stolen tasks
+        double_t busy_time = 0;
+    };
+    StealCounter steal_counter;
+
+    // Role in the pipeline topology: full analysis (grouping and encoding only when it has
+    // spectral rings), STFT of the encoded windows, or scoring of the spectral frames
+    enum analyzer_role_t : uint8_t {
+        ROLE_FULL       = 0,
+        ROLE_SPECTRAL   = 1,
+        ROLE_SCORING    = 2
+    };
+    analyzer_role_t role = ROLE_FULL;
+    // Complete scoring windows of one flow at one resolution: encoded samples, then spectral frames
+    struct PipelineItem {
+        AnalyzerWorkerThread * p_owner;
+        uint32_t address;
+        uint8_t prefix_len;
+        uint8_t view;
+        uint8_t r;
+        size_t pkt_num;
+        size_t n_frame;
+        size_t hop;
+        vector<float> data;
+    };
+    using pipeline_ring_t = SpscRing<PipelineItem>;
+    // Rings from the upstream stage and to the downstream stage, one per pair of cores
+    vector<shared_ptr<pipeline_ring_t> > in_rings;
+    vector<shared_ptr<pipeline_ring_t> > out_rings;
+    size_t out_ring_cursor = 0;
+    // Items taken from one ring before the stage moves to the next
+    #define PIPELINE_BURST 32
+    // Items handled by a stage, and items analyzed in place since the downstream rings were full
+    size_t pipeline_item_num = 0;
+    size_t pipeline_inline_num = 0;
+
+    // Packets fetched from each parser per iteration, and the wait before it
+    #define MIN_FETCH_SIZE (1 << 10)
+    #define MAX_FETCH_SIZE (1 << 17)
+    size_t max_fetch = MAX_FETCH_SIZE;
+    size_t wait_time = 50000;
+    // Measurements and decisions of the adaptive batching
+    struct BatchController {
+        // EWMA of the analysis time per packet (s) and of the arrival rate (packet/s)
+        double_t pkt_cost = 0;
+        double_t arrival_rate = 0;
+        size_t batch_num = 0;
+        size_t over_target_num = 0;
+        double_t max_batch_time = 0;
+    };
+    BatchController batch_ctrl;
+
+    // Degradation levels of the load shedding, each level keeps the ones below
+    enum shed_level_t : uint8_t {
+        SHED_NONE = 0,
+        // flow-consistent sampling of the sources
+        SHED_SAMPLE = 1,
+        // STFT hop of the fast profile for the new frames
+        SHED_COARSE_HOP = 2,
+        // host flows of the first view neither heavy hitters nor one frame long in the batch are skipped
+        SHED_SKIP_LOW = 3,
+        // new addresses are analyzed per prefix only
+        SHED_PREFIX_ONLY = 4,
+        SHED_LEVEL_NUM = 5
+    };
+    // Read by the analyzers running the stolen flows of this one
+    atomic<uint8_t> shed_level{SHED_NONE};
+    // Measurements and decisions of the load shedding
+    struct ShedController {
+        // EWMA of the buffered share of the lanes before a fetch, and of the batch analysis time (s)
+        double_t backlog = 0;
+        double_t batch_time = 0;
+        // Start of the calm period, and of the current level
+        double_t calm_since = 0;
+        double_t level_since = 0;
+        double_t level_time[SHED_LEVEL_NUM] = {0};
+        size_t level_change_num = 0;
+        uint8_t max_level = SHED_NONE;
+        // Packets dropped by the sampling, of skipped flows, and grouped per prefix by the prefix-only level
+        size_t sample_pkt_num = 0;
+        size_t skip_pkt_num = 0;
+        size_t prefix_pkt_num = 0;
+    };
+    ShedController shed_ctrl;
+    SeededHash shed_hash;
     const double_t max_cluster_dist = 1e12;
     
-    // Copy per-packet properties form registed ParserWorkers
-    auto fetch_form_parser(const shared_ptr<ParserWorkerThread> pt) const -> size_t;
+    // Copy per-packet properties form registed ParserWorkers, with the semaphore of the lane held
+    auto fetch_form_parser(const shared_ptr<ParserLane> pt) const -> size_t;
+    // Merge the fetched segments by timestamp, so that the packets of a source are in time order
+    // whichever parser they came through
+    void merge_by_time();
+    // Block until a parser signals, or at most wait_time, as of the wait mode
+    void wait_for_parser();
+    // Set the fetch size and the wait time of the next iteration toward the latency target
+    void adapt_batch(size_t n_fetch, double_t span, double_t analyze_time);
+    // Buffered share of the registed lanes
+    auto lane_backlog() const -> double_t;
+    // Move the load shedding one level up or down from the backlog and the time of the last batch
+    void adapt_shedding(double_t backlog_share, double_t analyze_time);
+    // STFT hop of the new frames at resolution r, as of the load shedding level
+    auto inline frame_hop(size_t r) const -> size_t {
+        return shed_level.load(memory_order_relaxed) >= SHED_COARSE_HOP ? resolutions[r].shed_hop : resolutions[r].stft_hop;
+    }
+    // Run a flow task of the owner analyzer
+    void run_task(AnalyzerWorkerThread & owner, const FlowTask & task);
+    // Run the tasks of other analyzers until none is left, the number of tasks run
+    auto steal_tasks() -> size_t;
+    // Pass the complete windows of a flow at resolution r to the spectral stage, all remaining frames when flushed
+    void ship_flow(FlowState & flow, size_t r, bool flush);
+    // Push an item to the next downstream ring with room, false if all are full
+    auto push_downstream(PipelineItem && item) -> bool;
+    // Main loop of the spectral and scoring stages
+    void run_stage();
+    void spectral_stage(PipelineItem & item);
+    void scoring_stage(PipelineItem & item);
     // Extract Frequency Domain Representation from per-packet properties
     void wave_analyze();
-    // Linear Tranformation of per-packet properties
-    auto static inline weight_transform(const PacketMetaData & info) -> double_t;
+    // Update the first stage of a flow and decide whether it goes to the frequency domain analysis
+    void cascade_stage(FlowState & flow, const size_t * p_index, size_t n);
+    // Consume a flow gated by the first stage
+    void cascade_gate(FlowState & flow);
+    // Take the top-K of the summary and decay it at the epoch boundary
+    void update_heavy_hitter();
+    auto is_heavy_hitter(uint64_t key) const -> bool;
+    // Grouping key of an address not admitted to the flow table of view v
+    auto aggregate_key(uint32_t addr, size_t v, size_t & aggregate_room, const batch_map_t & mp) -> uint64_t;
+    auto find_flow(uint64_t key) -> FlowState *;
+    auto find_or_insert_flow(uint64_t key) -> FlowState &;
+    // Encode and analyze packets of a flow
+    void analyze_packets(FlowState & flow, const size_t * p_index, size_t n);
+    // Frames of the batch were fed to the learner
+    bool is_train_fed = false;
+    // Score all pending frames of a flow
+    void flush_flow(FlowState & flow);
+    // Score an evicted flow if it is long enough
+    void finalize_flow(FlowState & flow);
+    // A flow ending without any frame, whose samples go to the low-rate sketch
+    auto is_short_flow(const FlowState & flow) const -> bool;
+    void fold_low_rate(FlowState & flow);
+    // Score a flow at the end of its epoch
+    void close_epoch(FlowState & flow);
+    // STFT on the unconsumed samples of a flow at resolution r, append the new frames to the flow and return them
+    auto transform_flow(FlowState & flow, size_t r) -> torch::Tensor;
+    // Slide the encoded packets into the DFT state of a flow at resolution r, append the emitted frames and return them
+    auto slide_flow(FlowState & flow, size_t r, const float * p_enc, size_t n) -> torch::Tensor;
+    // Score the complete windows of a flow at resolution r, or all pending frames when flushed
+    void score_flow(FlowState & flow, size_t r, bool flush);
+    // Verbose and save the score of a flow
+    void record_result(uint32_t address, uint8_t prefix_len, double_t min_dist, size_t pkt_num, 
+                       size_t n_fft, bool is_destination, record_kind_t kind = RECORD_SCORE);
+    // Sample the frames of a flow as training data of resolution r in view v
+    void feed_learner(const torch::Tensor & ten_res, size_t r, size_t v);
+    // STFT, power and log transformation of an encoded flow, result in [frame, freq]
+    auto spectrum_transform(const torch::Tensor & ten, size_t r, size_t hop, 
+                            const torch::Tensor & window) -> torch::Tensor;
+    // Max-of-min distance between the frame windows and the clustering centers of a model
+    auto center_distance(const torch::Tensor & ten_res, const ClusterModel & model) const -> double_t;
 
 public:
 
-    AnalyzerWorkerThread(const vector<shared_ptr<ParserWorkerThread> > & _vp, 
-                         const shared_ptr<KMeansLearner> _pl) : p_parser(_vp), p_learner(_pl) {}
+    AnalyzerWorkerThread(const vector<shared_ptr<ParserLane> > & _vp, 
+                         const shared_ptr<KMeansLearner> _pl) : p_learner_vec({_pl}), p_lane(_vp) {}
 
-    AnalyzerWorkerThread(const vector<shared_ptr<ParserWorkerThread> > & _vp, 
+    AnalyzerWorkerThread(const vector<shared_ptr<ParserLane> > & _vp, 
                          const shared_ptr<KMeansLearner> _pl,
-                         const json & _j) : p_parser(_vp), p_learner(_pl) {
+                         const json & _j) : p_learner_vec({_pl}), p_lane(_vp) {
                              configure_via_json(_j);
                          }
 
-    virtual ~AnalyzerWorkerThread() {}
+    // One learner per FFT size of n_fft_list in each analysis view
+    AnalyzerWorkerThread(const vector<shared_ptr<ParserLane> > & _vp, 
+                         const vector<shared_ptr<KMeansLearner> > & _vpl) : p_learner_vec(_vpl), p_lane(_vp) {}
+
+    virtual ~AnalyzerWorkerThread() {
+        if (wakeup_fd >= 0) {
+            close(wakeup_fd);
+        }
+    }
     AnalyzerWorkerThread & operator=(const AnalyzerWorkerThread &) = delete;
     AnalyzerWorkerThread(const AnalyzerWorkerThread &) = delete;
 
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "../common.hpp"
+
+#include <vector>
+#include <cstring>
+#include <cstddef>
+
+
+namespace Whisper
+{
+
+
+// Bump allocator for the scratch memory of one analysis batch.
+// Memory is handed out linearly from a pre-faulted block and released all at once by reset().
+// Requests beyond the block fall back to the heap and the block grows to the high-water mark on reset.
+class BatchArena final {
+
+private:
+
+    #define ARENA_ALIGN 64
+
+    char * p_block = nullptr;
+    size_t block_size = 0;
+    size_t block_used = 0;
+
+    // Heap fallbacks when the block is exhausted, freed on reset
+    std::vector<void *> overflow_vec;
+    size_t overflow_size = 0;
+
+    auto static inline align_up(size_t v, size_t a) -> size_t {
+        return (v + a - 1) & ~(a - 1);
+    }
+
+    void alloc_block(size_t sz) {
+        block_size = align_up(sz, ARENA_ALIGN);
+        p_block = static_cast<char *>(aligned_alloc(ARENA_ALIGN, block_size));
+        if (p_block == nullptr) {
+            FATAL_ERROR("Batch arena: bad allocation.");
+        }
+        // pre-fault the pages on the core that uses them
+        memset(p_block, 0, block_size);
+    }
+
+public:
+
+    // Statistics of current batch
+    struct ArenaStat {
+        size_t alloc_num = 0;
+        size_t alloc_size = 0;
+        size_t overflow_num = 0;
+        size_t overflow_size = 0;
+    };
+    ArenaStat batch_stat;
+    // Largest batch footprint so far
+    size_t high_water = 0;
+
+    explicit BatchArena(size_t sz) {
+        alloc_block(sz);
+    }
+
+    virtual ~BatchArena() {
+        reset();
+        free(p_block);
+    }
+    BatchArena & operator=(const BatchArena &) = delete;
+    BatchArena(const BatchArena &) = delete;
+
+    auto allocate(size_t sz, size_t align = alignof(max_align_t)) -> void * {
+        ++ batch_stat.alloc_num;
+        batch_stat.alloc_size += sz;
+
+        const size_t start = align_up(block_used, align);
+        if (start + sz <= block_size) {
+            block_used = start + sz;
+            return p_block + start;
+        }
+
+        void * p = aligned_alloc(ARENA_ALIGN, align_up(sz, ARENA_ALIGN));
+        if (p == nullptr) {
+            FATAL_ERROR("Batch arena: overflow bad allocation.");
+        }
+        overflow_vec.push_back(p);
+        overflow_size += sz;
+        ++ batch_stat.overflow_num;
+        batch_stat.overflow_size += sz;
+        return p;
+    }
+
+    template<typename T>
+    auto allocate_array(size_t n) -> T * {
+        return static_cast<T *>(allocate(n * sizeof(T), std::max(alignof(T), (size_t) ARENA_ALIGN)));
+    }
+
+    // Release all memory of current batch
+    void reset() {
+        const size_t footprint = block_used + overflow_size;
+        high_water = std::max(high_water, footprint);
+        for (auto p : overflow_vec) {
+            free(p);
+        }
+        overflow_vec.clear();
+        block_used = 0;
+
+        // grow the block, so that a batch of the same size fits next time
+        if (overflow_size != 0) {
+            free(p_block);
+            alloc_block(high_water + (high_water >> 2));
+        }
+        overflow_size = 0;
+        batch_stat = ArenaStat();
+    }
+
+    auto inline capacity() const -> size_t {
+        return block_size;
+    }
+
+};
+
+
+// STL allocator over the batch arena, deallocation is deferred to BatchArena::reset().
+// Not final, the containers of libstdc++ derive from their allocator.
+template<typename T>
+struct ArenaAllocator {
+
+    using value_type = T;
+
+    BatchArena * p_arena;
+
+    explicit ArenaAllocator(BatchArena * p) noexcept : p_arena(p) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U> & other) noexcept : p_arena(other.p_arena) {}
+
+    auto allocate(size_t n) -> T * {
+        return static_cast<T *>(p_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T *, size_t) noexcept {}
+
+    template<typename U>
+    auto operator==(const ArenaAllocator<U> & other) const noexcept -> bool {
+        return p_arena == other.p_arena;
+    }
+    template<typename U>
+    auto operator!=(const ArenaAllocator<U> & other) const noexcept -> bool {
+        return p_arena != other.p_arena;
+    }
+
+};
+
+
+}
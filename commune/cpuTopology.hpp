@@ -0,0 +1,112 @@
+#pragma once
+
+#include "../common.hpp"
+
+#include <vector>
+#include <string>
+
+
+namespace Whisper
+{
+
+
+// CPU and NIC topology read from /sys, for the placement of the worker threads
+struct CpuTopology final {
+
+    struct Core {
+        size_t id;
+        // NUMA node, lowest core sharing the physical core (hyperthread siblings), lowest core sharing the L3
+        int node = 0;
+        size_t sibling_group;
+        size_t l3_group;
+    };
+    // Online cores in ascending order of id
+    std::vector<Core> cores;
+
+    // Parse a kernel cpu list, e.g. "0-3,8,10-11"
+    static auto parse_cpu_list(const std::string & s) -> std::vector<size_t> {
+        std::vector<size_t> res;
+        std::stringstream ss(s);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            if (item.empty() || !isdigit(item[0])) {
+                continue;
+            }
+            const size_t dash = item.find('-');
+            const size_t lo = std::stoul(item.substr(0, dash));
+            const size_t hi = dash == std::string::npos ? lo : std::stoul(item.substr(dash + 1));
+            for (size_t c = lo; c <= hi; c ++) {
+                res.push_back(c);
+            }
+        }
+        return res;
+    }
+
+    // First line of a /sys file, empty if it can not be read
+    static auto read_line(const std::string & path) -> std::string {
+        std::ifstream fin(path);
+        std::string line;
+        if (fin) {
+            std::getline(fin, line);
+        }
+        return line;
+    }
+
+    // The first core of a cpu list file, or the core itself if unknown
+    static auto first_of(const std::string & path, size_t self) -> size_t {
+        const auto ve = parse_cpu_list(read_line(path));
+        return ve.empty() ? self : ve[0];
+    }
+
+    // NUMA node of a PCI device, 0 if unknown
+    static auto pci_numa_node(const std::string & pci_address) -> int {
+        const std::string s = read_line("/sys/bus/pci/devices/" + pci_address + "/numa_node");
+        if (s.empty()) {
+            return 0;
+        }
+        return std::max(std::stoi(s), 0);
+    }
+
+    void load() {
+        static const std::string cpu_root = "/sys/devices/system/cpu/";
+        cores.clear();
+        for (const auto c : parse_cpu_list(read_line(cpu_root + "online"))) {
+            Core core;
+            core.id = c;
+            const std::string dir = cpu_root + "cpu" + std::to_string(c) + "/";
+            core.sibling_group = first_of(dir + "topology/thread_siblings_list", c);
+            // the last level shared cache is index3 on the usual x86 servers
+            core.l3_group = c;
+            for (size_t i = 0; i < 8; i ++) {
+                const std::string cache = dir + "cache/index" + std::to_string(i) + "/";
+                if (read_line(cache + "level") == "3") {
+                    core.l3_group = first_of(cache + "shared_cpu_list", c);
+                    break;
+                }
+            }
+            cores.push_back(core);
+        }
+
+        // the node of each core from the core lists of the nodes
+        for (size_t n = 0; n < 1024; n ++) {
+            const std::string s = read_line("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+            if (s.empty()) {
+                if (n != 0) {
+                    break;
+                }
+                continue;
+            }
+            for (const auto c : parse_cpu_list(s)) {
+                for (auto & core : cores) {
+                    if (core.id == c) {
+                        core.node = (int) n;
+                    }
+                }
+            }
+        }
+    }
+
+};
+
+
+}
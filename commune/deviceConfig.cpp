@@ -1,10 +1,18 @@
 #include "deviceConfig.hpp"
 #include "parserWorker.hpp"
 
+#include <functional>
+
 using namespace Whisper;
 using namespace pcpp;
 
 
+// Mask of the n lowest cores, on the full width of CoreMask
+static inline auto low_core_mask(size_t n) -> CoreMask {
+	return n >= sizeof(CoreMask) * 8 ? ~((CoreMask) 0) : (((CoreMask) 1) << n) - 1;
+}
+
+
 void DeviceConfig::list_dpdk_ports() const 
 {
 	if (verbose) {
@@ -15,7 +23,7 @@ void DeviceConfig::list_dpdk_ports() const
 	if (p_configure_param->core_num <= 1) {
 		core_mask_use = getCoreMaskForAllMachineCores();
 	} else {
-		core_mask_use = (1 << p_configure_param->core_num) - 1;
+		core_mask_use = low_core_mask(p_configure_param->core_num);
 	}
 	
 	printf("----- Display DPDK setting -----\n");
@@ -109,6 +117,110 @@ auto DeviceConfig::assign_queue_to_parser(const device_list_t & dev_list,
 }
 
 
+auto DeviceConfig::plan_core_placement(const device_list_t & dev_list, 
+										vector<cpu_core_id_t> & parser_cores, 
+										vector<cpu_core_id_t> & analyzer_cores) const -> bool
+{
+	CpuTopology topo;
+	topo.load();
+	if (topo.cores.empty()) {
+		WARN("CPU topology not found in /sys.");
+		return false;
+	}
+
+	// the parsers poll the NICs, they go to the node of the first NIC
+	const int nic_node = dev_list.empty() ? 0 : CpuTopology::pci_numa_node(dev_list[0]->getPciAddress());
+
+	using core_t = CpuTopology::Core;
+	const cpu_core_id_t master_core = DpdkDeviceList::getInstance().getDpdkMasterCore().Id;
+	vector<const core_t *> free_cores;
+	for (const auto & core : topo.cores) {
+		if (core.id < MAX_NUM_OF_CORES && core.id != master_core) {
+			free_cores.push_back(&core);
+		}
+	}
+	vector<bool> used(free_cores.size(), false);
+	// take the first free core satisfying the preferences, in their order
+	const auto _f_take = [&] (const vector<function<bool(const core_t &)> > & pref) -> const core_t * {
+		for (const auto & f : pref) {
+			for (size_t i = 0; i < free_cores.size(); i ++) {
+				if (!used[i] && f(*free_cores[i])) {
+					used[i] = true;
+					return free_cores[i];
+				}
+			}
+		}
+		return nullptr;
+	};
+	const auto _f_log = [] (const char * name, size_t i, const core_t * p) -> void {
+		LOGF("Core layout: %s #%ld on core %ld [node %d, physical core %ld, L3 of core %ld].", 
+			 name, i, p->id, p->node, p->sibling_group, p->l3_group);
+	};
+
+	// parsers on the node of the NIC, never two on the hyperthreads of one physical core
+	unordered_set<size_t> parser_groups;
+	const auto _f_off_parser = [&] (const core_t & c) -> bool {
+		return parser_groups.count(c.sibling_group) == 0;
+	};
+	vector<const core_t *> parser_topo;
+	for (size_t i = 0; i < p_configure_param->core_use_for_parser; i ++) {
+		const auto p = _f_take({
+			[&] (const core_t & c) { return c.node == nic_node && _f_off_parser(c); },
+			_f_off_parser,
+			[] (const core_t &) { return true; }
+		});
+		if (p == nullptr) {
+			WARN("Not enough cores for the parsers.");
+			return false;
+		}
+		parser_groups.insert(p->sibling_group);
+		parser_topo.push_back(p);
+		parser_cores.push_back(p->id);
+		_f_log("parser", i, p);
+	}
+
+	// each analyzer shares the L3 of its first parser, as bound in create_worker_threads
+	const size_t n_parser = p_configure_param->core_use_for_parser;
+	const size_t parser_per_analyzer = n_parser / p_configure_param->core_use_for_analyze;
+	vector<const core_t *> analyzer_topo;
+	for (size_t i = 0; i < p_configure_param->core_use_for_analyze; i ++) {
+		const auto & home = *parser_topo[parser_per_analyzer != 0 ? i * parser_per_analyzer : i % n_parser];
+		const auto p = _f_take({
+			[&] (const core_t & c) { return c.l3_group == home.l3_group && _f_off_parser(c); },
+			[&] (const core_t & c) { return c.node == home.node && _f_off_parser(c); },
+			_f_off_parser,
+			[] (const core_t &) { return true; }
+		});
+		if (p == nullptr) {
+			WARN("Not enough cores for the analyzers.");
+			return false;
+		}
+		analyzer_topo.push_back(p);
+		analyzer_cores.push_back(p->id);
+		_f_log("analyzer", i, p);
+	}
+
+	// the pipeline stages serve all analyzers, each shares the L3 of one of them in turn
+	const size_t n_stage = p_configure_param->pipeline_spectral_core + p_configure_param->pipeline_scoring_core;
+	for (size_t i = 0; i < n_stage; i ++) {
+		const auto & home = *analyzer_topo[i % analyzer_topo.size()];
+		const auto p = _f_take({
+			[&] (const core_t & c) { return c.l3_group == home.l3_group && _f_off_parser(c); },
+			[&] (const core_t & c) { return c.node == home.node && _f_off_parser(c); },
+			_f_off_parser,
+			[] (const core_t &) { return true; }
+		});
+		if (p == nullptr) {
+			WARN("Not enough cores for the pipeline stages.");
+			return false;
+		}
+		analyzer_cores.push_back(p->id);
+		_f_log("pipeline stage", i, p);
+	}
+	return true;
+}
+
+
 auto DeviceConfig::create_worker_threads(const assign_queue_t & queue_assign,
 						vector<shared_ptr<ParserWorkerThread> > & parser_thread_vec,
 						vector<shared_ptr<AnalyzerWorkerThread> > & analyzer_thread_vec) -> bool
@@ -136,42 +248,84 @@ auto DeviceConfig::create_worker_threads(const assign_queue_t & queue_assign,
 	}
 #endif
 
-	size_t parser_per_analyzer = parser_thread_vec.size() / 
-				(size_t) p_configure_param->core_use_for_analyze;
-	
-	size_t parser_remain = parser_thread_vec.size() - 
-				((size_t) p_configure_param->core_use_for_analyze * parser_per_analyzer);
-	
-	using ptr_vec_for_parser = vector<shared_ptr<ParserWorkerThread> >;
-	vector<ptr_vec_for_parser> ve_all;
-	for (cpu_core_id_t i = 0; i < p_configure_param->core_use_for_analyze; i ++) {
-		ptr_vec_for_parser ve(parser_thread_vec.begin() + ( i		* parser_per_analyzer), 
-							  parser_thread_vec.begin() + ((i + 1) * parser_per_analyzer));
-		ve_all.push_back(ve);
+	vector<bool> view_list = {false};
+	if (j_cfg_analyzer.count("analysis_view") && 
+		analysis_view_map.count(j_cfg_analyzer["analysis_view"].get<string>())) {
+		view_list = analysis_view_map.at(j_cfg_analyzer["analysis_view"].get<string>());
 	}
 
-	assert(parser_remain <= ve_all.size());
-	for (int i = 0; i < parser_remain; i ++) {
-		ve_all[i].push_back(parser_thread_vec[parser_thread_vec.size() - i - 1]);
+	// fan-out topology: with no more analyzers than parsers, each analyzer takes a slice of the parsers;
+	// with more, analyzer i is fed by parser i % #parser, through a lane of its own
+	const size_t n_parser = parser_thread_vec.size();
+	const size_t n_analyzer = p_configure_param->core_use_for_analyze;
+	using ptr_vec_for_lane = vector<shared_ptr<ParserLane> >;
+	vector<ptr_vec_for_lane> ve_all(n_analyzer);
+	if (n_analyzer <= n_parser) {
+		size_t parser_per_analyzer = n_parser / n_analyzer;
+		size_t parser_remain = n_parser - n_analyzer * parser_per_analyzer;
+		for (size_t i = 0; i < n_analyzer; i ++) {
+			for (size_t j = i * parser_per_analyzer; j < (i + 1) * parser_per_analyzer; j ++) {
+				ve_all[i].push_back(parser_thread_vec[j]->lanes[0]);
+			}
+		}
+		for (size_t i = 0; i < parser_remain; i ++) {
+			ve_all[i].push_back(parser_thread_vec[n_parser - i - 1]->lanes[0]);
+		}
+	} else {
+		// a packet goes to one lane, chosen by the address of the view, so that all packets of an
+		// address meet in one analyzer. Both views at once would need each packet in two lanes.
+		if (view_list.size() != 1) {
+			WARN("Fan-out of parsers to more analyzers supports one analysis view (source or destination).");
+			return false;
+		}
+		for (size_t j = 0; j < n_parser; j ++) {
+			parser_thread_vec[j]->lane_by_destination = view_list[0];
+			parser_thread_vec[j]->set_lane_num((n_analyzer - j + n_parser - 1) / n_parser);
+		}
+		for (size_t i = 0; i < n_analyzer; i ++) {
+			ve_all[i].push_back(parser_thread_vec[i % n_parser]->lanes[i / n_parser]);
+		}
 	}
 
-	// Create KMeansLearner for Analyzer
-	const auto & p_k_learner = make_shared<KMeansLearner>();
-	if (p_k_learner == nullptr) {
-		return false;
-	}
-	if (j_cfg_kmeans.size() != 0) {
-		p_k_learner->configure_via_json(j_cfg_kmeans);
+	// Create KMeansLearner for Analyzer, one for each FFT size of the analysis in each view
+	vector<size_t> n_fft_list = {0};
+	if (j_cfg_analyzer.count("n_fft") && j_cfg_analyzer["n_fft"].is_array() && !j_cfg_analyzer["n_fft"].empty()) {
+		n_fft_list = j_cfg_analyzer["n_fft"].get<vector<size_t> >();
 	}
+	vector<shared_ptr<KMeansLearner> > k_learner_vec;
+	for (size_t v = 0; v < view_list.size(); v ++) {
+		for (size_t r = 0; r < n_fft_list.size(); r ++) {
+			const auto & p_k_learner = make_shared<KMeansLearner>();
+			if (p_k_learner == nullptr) {
+				return false;
+			}
+			if (j_cfg_kmeans.size() != 0) {
+				p_k_learner->configure_via_json(j_cfg_kmeans);
+			}
+			// the centers of the secondary resolutions and of the destination view are saved beside the primary ones
+			string file_suffix = r == 0 ? "" : "." + to_string(n_fft_list[r]);
+			if (view_list[v]) {
+				file_suffix += ".dst";
+			}
+			const auto & p_cfg = p_k_learner->p_learner_config;
+			if (p_cfg->save_result_file.length() != 0) {
+				p_cfg->save_result_file += file_suffix;
+			}
+			if (p_cfg->load_result_file.length() != 0) {
+				p_cfg->load_result_file += file_suffix;
+			}
 #ifdef DISP_PARAM
-	if (verbose) {
-		p_k_learner->p_learner_config->display_params();
-	}
+			if (verbose) {
+				p_k_learner->p_learner_config->display_params();
+			}
 #endif
+			k_learner_vec.push_back(p_k_learner);
+		}
+	}
 
-	// bind the KMeans Learner and the ParserWorkers to the AnalyzeWorker
+	// bind the KMeans Learners and the ParserWorkers to the AnalyzeWorker
 	for (cpu_core_id_t i = 0; i < p_configure_param->core_use_for_analyze; i ++) {
-		const auto p_new_analyzer = make_shared<AnalyzerWorkerThread>(ve_all[i], p_k_learner);
+		const auto p_new_analyzer = make_shared<AnalyzerWorkerThread>(ve_all[i], k_learner_vec);
 		if (p_new_analyzer == nullptr) {
 			return false;
 		}
@@ -183,6 +337,57 @@ auto DeviceConfig::create_worker_threads(const assign_queue_t & queue_assign,
 		analyzer_thread_vec.push_back(p_new_analyzer);
 	}
 
+	// every analyzer may steal the flow tasks of the others
+	for (const auto & p_analyzer : analyzer_thread_vec) {
+		for (const auto & p_peer : analyzer_thread_vec) {
+			if (p_peer != p_analyzer) {
+				p_analyzer->peers.push_back(p_peer.get());
+			}
+		}
+	}
+
+	// the stages of the pipeline, connected by one ring per pair of cores of adjacent stages
+	if (p_configure_param->pipeline_spectral_core != 0) {
+		if (analyzer_thread_vec[0]->p_analyzer_config->spectrum_mode != "stft") {
+			WARN("Pipelined analysis requires the STFT spectrum mode.");
+			return false;
+		}
+		const auto _f_create_stage = [&] (cpu_core_id_t n, AnalyzerWorkerThread::analyzer_role_t role) 
+				-> vector<shared_ptr<AnalyzerWorkerThread> > {
+			vector<shared_ptr<AnalyzerWorkerThread> > stage;
+			for (cpu_core_id_t i = 0; i < n; i ++) {
+				const auto p_new_stage = make_shared<AnalyzerWorkerThread>(
+						vector<shared_ptr<ParserLane> >(), k_learner_vec);
+				if (j_cfg_analyzer.size() != 0) {
+					p_new_stage->configure_via_json(j_cfg_analyzer);
+				}
+				p_new_stage->role = role;
+				stage.push_back(p_new_stage);
+			}
+			return stage;
+		};
+		const auto _f_connect = [this] (const vector<shared_ptr<AnalyzerWorkerThread> > & up, 
+										const vector<shared_ptr<AnalyzerWorkerThread> > & down) -> void {
+			for (const auto & p_up : up) {
+				for (const auto & p_down : down) {
+					const auto p_ring = make_shared<AnalyzerWorkerThread::pipeline_ring_t>(
+							p_configure_param->pipeline_ring_size);
+					p_up->out_rings.push_back(p_ring);
+					p_down->in_rings.push_back(p_ring);
+				}
+			}
+		};
+
+		const auto spectral_vec = _f_create_stage(p_configure_param->pipeline_spectral_core, 
+												  AnalyzerWorkerThread::ROLE_SPECTRAL);
+		const auto scoring_vec = _f_create_stage(p_configure_param->pipeline_scoring_core, 
+												 AnalyzerWorkerThread::ROLE_SCORING);
+		_f_connect(analyzer_thread_vec, spectral_vec);
+		_f_connect(spectral_vec, scoring_vec);
+		analyzer_thread_vec.insert(analyzer_thread_vec.end(), spectral_vec.cbegin(), spectral_vec.cend());
+		analyzer_thread_vec.insert(analyzer_thread_vec.end(), scoring_vec.cbegin(), scoring_vec.cend());
+	}
+
 #ifdef DISP_PARAM
 	if (verbose) {
 		analyzer_thread_vec[0]->p_analyzer_config->display_params();
@@ -193,6 +398,170 @@ auto DeviceConfig::create_worker_threads(const assign_queue_t & queue_assign,
 }
 
 
+void DeviceConfig::rebalance_queues(const vector<shared_ptr<ParserWorkerThread> > & parser_thread_vec, 
+									double_t span) const
+{
+	struct ParserLoad {
+		double_t pkt_rate = 0;
+		uint64_t poll_num = 0;
+		uint64_t busy_poll_num = 0;
+		vector<RxQueueState *> queues;
+	};
+	unordered_map<ParserWorkerThread *, ParserLoad> load;
+	bool is_pending = false;
+	for (const auto & p_parser : parser_thread_vec) {
+		load[p_parser.get()];
+		is_pending |= p_parser->mailbox.has_mail.load(memory_order_acquire);
+	}
+
+	// rates of each queue and load of each parser since the last decision
+	for (const auto & p_parser : parser_thread_vec) {
+		for (const auto & p_queue : p_parser->rx_queue_state_vec) {
+			const uint64_t pkt_num = p_queue->pkt_num.load(memory_order_relaxed);
+			const uint64_t poll_num = p_queue->poll_num.load(memory_order_relaxed);
+			const uint64_t busy_poll_num = p_queue->busy_poll_num.load(memory_order_relaxed);
+			p_queue->pkt_rate = (pkt_num - p_queue->seen_pkt_num) / span;
+
+			auto & ref = load[p_queue->p_owner.load(memory_order_acquire)];
+			ref.pkt_rate += p_queue->pkt_rate;
+			ref.poll_num += poll_num - p_queue->seen_poll_num;
+			ref.busy_poll_num += busy_poll_num - p_queue->seen_busy_poll_num;
+			ref.queues.push_back(p_queue.get());
+
+			p_queue->seen_pkt_num = pkt_num;
+			p_queue->seen_poll_num = poll_num;
+			p_queue->seen_busy_poll_num = busy_poll_num;
+		}
+	}
+
+	stringstream ss;
+	ss << "Parser load:";
+	double_t sum_rate = 0;
+	ParserWorkerThread * p_max = nullptr, * p_min = nullptr;
+	for (const auto & p_parser : parser_thread_vec) {
+		const auto & ref = load[p_parser.get()];
+		ss << " core " << p_parser->getCoreId() << " [" << setprecision(3) << ref.pkt_rate / 1e6 << " Mpps, " 
+		   << ref.queues.size() << " queues, busy " << setprecision(3) 
+		   << 100.0 * ref.busy_poll_num / max(ref.poll_num, (uint64_t) 1) << "%]";
+		sum_rate += ref.pkt_rate;
+		if (p_max == nullptr || ref.pkt_rate > load[p_max].pkt_rate) {
+			p_max = p_parser.get();
+		}
+		// a parser without any queue of its own has exited
+		if (!p_parser->p_dpdk_config->nic_queue_list.empty() && 
+			(p_min == nullptr || ref.pkt_rate < load[p_min].pkt_rate)) {
+			p_min = p_parser.get();
+		}
+	}
+	if (verbose) {
+		LOGF("%s", ss.str().c_str());
+	}
+
+	// one migration per decision, after the previous one is done
+	const double_t mean_rate = sum_rate / parser_thread_vec.size();
+	if (is_pending || p_max == nullptr || p_min == nullptr || p_max == p_min || 
+		load[p_max].queues.size() < 2 || 
+		load[p_max].pkt_rate <= (1 + p_configure_param->rebalance_threshold) * mean_rate) {
+		return;
+	}
+
+	// the queue closest to half of the gap, among the ports the target parser already serves
+	const double_t gap = load[p_max].pkt_rate - load[p_min].pkt_rate;
+	RxQueueState * p_move = nullptr;
+	for (const auto p_queue : load[p_max].queues) {
+		if (p_queue->pkt_rate >= gap || p_min->p_dpdk_config->nic_queue_list.count(p_queue->dev) == 0) {
+			continue;
+		}
+		if (p_move == nullptr || fabs(p_queue->pkt_rate - gap / 2) < fabs(p_move->pkt_rate - gap / 2)) {
+			p_move = p_queue;
+		}
+	}
+	if (p_move == nullptr) {
+		return;
+	}
+
+	LOGF("Queue rebalance: DPDK port %d RX-Queue#%d [%4.2lf Mpps] from parser on core %d to core %d.", 
+		 p_move->dev->getDeviceId(), p_move->queue_id, p_move->pkt_rate / 1e6, 
+		 p_max->getCoreId(), p_min->getCoreId());
+	p_max->post_release(p_move, p_min);
+}
+
+
+void DeviceConfig::scale_analyzers(const vector<shared_ptr<AnalyzerWorkerThread> > & analyzer_thread_vec) const
+{
+	static const double_t alpha = 0.5;
+
+	// buffered share of the lanes of each analyzer in front of the pipeline
+	vector<AnalyzerWorkerThread *> active, parked;
+	stringstream ss;
+	ss << "Analyzer backlog:";
+	for (const auto & p_analyzer : analyzer_thread_vec) {
+		if (p_analyzer->role != AnalyzerWorkerThread::ROLE_FULL) {
+			continue;
+		}
+		const double_t share = p_analyzer->lane_backlog();
+		p_analyzer->backlog = (1 - alpha) * p_analyzer->backlog + alpha * share;
+		if (p_analyzer->is_parked.load(memory_order_relaxed)) {
+			parked.push_back(p_analyzer.get());
+			ss << " core " << p_analyzer->getCoreId() << " [parked]";
+		} else {
+			active.push_back(p_analyzer.get());
+			ss << " core " << p_analyzer->getCoreId() << " [" << setprecision(3) << 100.0 * p_analyzer->backlog << "%]";
+		}
+	}
+	if (verbose) {
+		LOGF("%s", ss.str().c_str());
+	}
+	if (active.empty()) {
+		return;
+	}
+
+	const auto _f_by_backlog = [] (const AnalyzerWorkerThread * a, const AnalyzerWorkerThread * b) -> bool {
+		return a->backlog < b->backlog;
+	};
+	const auto p_hot = *max_element(active.cbegin(), active.cend(), _f_by_backlog);
+	const auto p_cold = *min_element(active.cbegin(), active.cend(), _f_by_backlog);
+
+	// activate a parked analyzer, preferably one sharing a parser with the most backlogged one
+	if (p_hot->backlog > p_configure_param->scale_up_backlog && !parked.empty()) {
+		AnalyzerWorkerThread * p_up = parked[0];
+		for (const auto p_analyzer : parked) {
+			if (p_analyzer->p_lane[0]->p_parser == p_hot->p_lane[0]->p_parser) {
+				p_up = p_analyzer;
+				break;
+			}
+		}
+		for (const auto & p_lane : p_up->p_lane) {
+			p_lane->p_parser->activate_lane(p_lane->index);
+		}
+		p_up->is_parked.store(false, memory_order_relaxed);
+		LOGF("Analyzer scaling: activate analyzer on core %d [backlog of core %d: %4.1lf%%, %ld active].", 
+			 p_up->getCoreId(), p_hot->getCoreId(), 100.0 * p_hot->backlog, active.size() + 1);
+		return;
+	}
+
+	// park the least backlogged analyzer when all are nearly idle, if its parsers feed another one
+	if (p_hot->backlog < p_configure_param->scale_down_backlog && 
+		active.size() > p_configure_param->min_active_analyzer) {
+		for (const auto & p_lane : p_cold->p_lane) {
+			if (!p_lane->p_parser->park_lane(p_lane->index)) {
+				// a parser can not be left without any active lane, undo the lanes parked so far
+				for (const auto & p_back : p_cold->p_lane) {
+					if (p_back == p_lane) {
+						break;
+					}
+					p_back->p_parser->activate_lane(p_back->index);
+				}
+				return;
+			}
+		}
+		p_cold->is_parked.store(true, memory_order_relaxed);
+		LOGF("Analyzer scaling: park analyzer on core %d [max backlog %4.1lf%%, %ld active].", 
+			 p_cold->getCoreId(), 100.0 * p_hot->backlog, active.size() - 1);
+	}
+}
+
+
 void DeviceConfig::interrupt_callback(void* cookie) 
 {
 	ThreadStateManagement * args = (ThreadStateManagement *) cookie;
@@ -249,7 +618,8 @@ auto DeviceConfig::configure_dpdk_nic(const CoreMask mask_all_used_core) const -
 	if (dpdk_init_once) {
 		LOGF("DPDK has already init.");
 	} else {
-		if (!DpdkDeviceList::initDpdk(mask_all_used_core, p_configure_param->mbuf_pool_size)) {
+		if (!DpdkDeviceList::initDpdk(mask_all_used_core, p_configure_param->mbuf_pool_size, 
+									  p_configure_param->master_core)) {
 			FATAL_ERROR("Couldn't initialize DPDK.");
 		} else {
 			dpdk_init_once = true;
@@ -320,29 +690,77 @@ void DeviceConfig::do_init() {
 			return false;
 		}
 
-		CoreMask all_core_mask = getCoreMaskForAllMachineCores();
-		vector<SystemCore> all_core;
-		createCoreVectorFromCoreMask(all_core_mask, all_core);
-		size_t all_core_num = all_core.size();
-
-		if (all_core_num < p_param->core_num) {
-			WARN("Exceed all system core number.");
+		const size_t analyzer_thread_num = p_param->core_use_for_analyze + 
+										   p_param->pipeline_spectral_core + p_param->pipeline_scoring_core;
+		// the master core is shifted into the core mask of DPDK in every placement
+		if (p_param->master_core >= MAX_NUM_OF_CORES) {
+			WARNF("Master core %d exceeds maximum core number Libpcapplusplus supported.", p_param->master_core);
 			return false;
 		}
-		if (MAX_NUM_OF_CORES < p_param->core_num) {
-			WARN("Exceed maximum core number Libpcapplusplus supported.");
+		if (p_param->core_placement == "sequential") {
+			CoreMask all_core_mask = getCoreMaskForAllMachineCores();
+			vector<SystemCore> all_core;
+			createCoreVectorFromCoreMask(all_core_mask, all_core);
+			size_t all_core_num = all_core.size();
+
+			if (all_core_num < p_param->core_num) {
+				WARN("Exceed all system core number.");
+				return false;
+			}
+			if (MAX_NUM_OF_CORES < p_param->core_num) {
+				WARN("Exceed maximum core number Libpcapplusplus supported.");
+				return false;
+			}
+			if (p_param->core_num < 2) {
+				WARN("Needed minimum of 2 cores to start the application.");
+				return false;
+			}
+			// the master core runs no worker, each worker thread needs a core of its own
+			if (p_param->core_num < 1 + p_param->core_use_for_parser + analyzer_thread_num) {
+				WARNF("Core number conflicts: %ld cores needed (master, %ld parsers, %ld analyzers).", 
+					  1 + p_param->core_use_for_parser + analyzer_thread_num, 
+					  (size_t) p_param->core_use_for_parser, analyzer_thread_num);
+				return false;
+			}
+			if (p_param->master_core >= p_param->core_num) {
+				WARN("Master core out of the used cores.");
+				return false;
+			}
+		}
+		if (p_param->core_placement == "explicit") {
+			if (p_param->parser_core_vec.size() != p_param->core_use_for_parser || 
+				p_param->analyzer_core_vec.size() != analyzer_thread_num) {
+				WARN("Core lists conflict with the core numbers.");
+				return false;
+			}
+			unordered_set<cpu_core_id_t> core_set = {p_param->master_core};
+			for (const auto & ve : {p_param->parser_core_vec, p_param->analyzer_core_vec}) {
+				for (const auto id : ve) {
+					if (id >= MAX_NUM_OF_CORES) {
+						WARNF("Core %d exceeds maximum core number Libpcapplusplus supported.", id);
+						return false;
+					}
+					if (!core_set.insert(id).second) {
+						WARNF("Core %d used twice.", id);
+						return false;
+					}
+				}
+			}
+		}
+		if ((p_param->pipeline_spectral_core == 0) != (p_param->pipeline_scoring_core == 0)) {
+			WARN("Pipeline requires both spectral and scoring cores.");
 			return false;
 		}
-		if (p_param->core_num < 2) {
-			WARN("Needed minimum of 2 cores to start the application.");
+		if (p_param->core_use_for_analyze == 0 || p_param->core_use_for_parser == 0) {
+			WARN("Needed at least one parser and one analyzer.");
 			return false;
 		}
-		if (p_param->core_num < p_param->core_use_for_analyze + p_param->core_use_for_parser) {
-			WARN("Core number conflicts.");
+		if (p_param->core_use_for_analyze > p_param->core_use_for_parser * LANE_BUCKET_NUM) {
+			WARN("Too many analyzers for the lanes of the parsers.");
 			return false;
 		}
-		if (p_param->core_use_for_analyze % p_param->core_use_for_parser != 0) {
-			WARN("Imbalanced core numbers for analyzer and parser.");
+		if (p_param->min_active_analyzer == 0 || p_param->min_active_analyzer > p_param->core_use_for_analyze) {
+			WARN("Invalid minimum number of active analyzers.");
 			return false;
 		}
 		return true;
@@ -355,27 +773,79 @@ void DeviceConfig::do_init() {
 	// configure PcapPlusPlus Log Error Level
 	LoggerPP::getInstance().suppressErrors();
 
-	// use 1 core for DPDK master and 17 cores for workers
-	vector<SystemCore> cores_to_use;
-	CoreMask core_mask_to_use = (1 << p_configure_param->core_num) - 1;
+	// the cores of the parsers and of the analyzers (the pipeline stages after them), in thread order
+	const auto & placement = p_configure_param->core_placement;
+	const size_t analyzer_thread_num = p_configure_param->core_use_for_analyze + 
+			p_configure_param->pipeline_spectral_core + p_configure_param->pipeline_scoring_core;
+	vector<cpu_core_id_t> parser_core_id, analyzer_core_id;
+
+	// use 1 core for DPDK master and the others for workers,
+	// the automatic placement starts DPDK on all cores to find the NUMA node of the NICs first
+	CoreMask core_mask_to_use = 0;
+	if (placement == "sequential") {
+		core_mask_to_use = low_core_mask(p_configure_param->core_num);
+	} else if (placement == "explicit") {
+		parser_core_id = p_configure_param->parser_core_vec;
+		analyzer_core_id = p_configure_param->analyzer_core_vec;
+		core_mask_to_use = ((CoreMask) 1) << p_configure_param->master_core;
+		for (const auto id : parser_core_id) {
+			core_mask_to_use |= ((CoreMask) 1) << id;
+		}
+		for (const auto id : analyzer_core_id) {
+			core_mask_to_use |= ((CoreMask) 1) << id;
+		}
+	} else {
+		core_mask_to_use = getCoreMaskForAllMachineCores() & low_core_mask(MAX_NUM_OF_CORES);
+	}
 
 	// configure DPDK
 	const auto device_list = this->configure_dpdk_nic(core_mask_to_use);
 
 	// prepare configuration for every core
 	CoreMask core_without_master = core_mask_to_use & ~(DpdkDeviceList::getInstance().getDpdkMasterCore().Mask);
-	CoreMask core_mask_parser = core_without_master & ((1 << (1 + p_configure_param->core_use_for_analyze)) - 1);
-	CoreMask core_mask_analyzer = core_without_master & ~core_mask_parser;
+	if (placement == "sequential") {
+		vector<SystemCore> core_worker;
+		createCoreVectorFromCoreMask(core_without_master, core_worker);
+		for (size_t i = 0; i < core_worker.size(); i ++) {
+			if (i < p_configure_param->core_use_for_parser) {
+				parser_core_id.push_back(core_worker[i].Id);
+			} else if (i < p_configure_param->core_use_for_parser + analyzer_thread_num) {
+				analyzer_core_id.push_back(core_worker[i].Id);
+			}
+		}
+	} else if (placement == "auto") {
+		if (!plan_core_placement(device_list, parser_core_id, analyzer_core_id)) {
+			FATAL_ERROR("Core placement failed.");
+		}
+	}
 
-	vector<SystemCore> core_parser;
-	createCoreVectorFromCoreMask(core_mask_parser, core_parser);
-	vector<SystemCore> core_analyzer;
-	createCoreVectorFromCoreMask(core_mask_analyzer, core_analyzer);
+	stringstream ss;
+	ss << "Core layout: master " << static_cast<int>(DpdkDeviceList::getInstance().getDpdkMasterCore().Id) << ", parsers [";
+	for (const auto id : parser_core_id) {
+		ss << id << ", ";
+	}
+	ss << "], analyzers [";
+	for (const auto id : analyzer_core_id) {
+		ss << id << ", ";
+	}
+	ss << "]";
+	LOGF("%s", ss.str().c_str());
+
+	CoreMask core_mask_parser = 0, core_mask_analyzer = 0;
+	vector<SystemCore> core_parser, core_analyzer;
+	for (const auto id : parser_core_id) {
+		core_mask_parser |= ((CoreMask) 1) << id;
+		core_parser.push_back(SystemCores::IdToSystemCore[id]);
+	}
+	for (const auto id : analyzer_core_id) {
+		core_mask_analyzer |= ((CoreMask) 1) << id;
+		core_analyzer.push_back(SystemCores::IdToSystemCore[id]);
+	}
 
 	assert((core_mask_analyzer & core_mask_parser) == 0);
-	assert(core_mask_analyzer | core_mask_parser == core_without_master);
-	assert(core_mask_analyzer | core_mask_parser | 
-			DpdkDeviceList::getInstance().getDpdkMasterCore().Mask == core_mask_to_use);
+	assert(((core_mask_analyzer | core_mask_parser) & ~core_without_master) == 0);
+	assert(core_parser.size() == p_configure_param->core_use_for_parser);
+	assert(core_analyzer.size() == analyzer_thread_num);
 
 	assign_queue_t nic_queue_assign = assign_queue_to_parser(device_list, core_parser);
 
@@ -387,20 +857,37 @@ void DeviceConfig::do_init() {
 		FATAL_ERROR("Thread allocation failed.");
 	}
 
+	// DPDK runs the threads on the cores of the mask in ascending order of core id
+	using core_thread_t = vector<pair<cpu_core_id_t, DpdkWorkerThread *> >;
+	const auto _f_by_core = [] (core_thread_t & ve) -> vector<DpdkWorkerThread *> {
+		stable_sort(ve.begin(), ve.end(), [] (const core_thread_t::value_type & a, 
+											  const core_thread_t::value_type & b) -> bool {
+			return a.first < b.first;
+		});
+		vector<DpdkWorkerThread *> res;
+		for (const auto & ref : ve) {
+			res.push_back(ref.second);
+		}
+		return res;
+	};
+	core_thread_t _parser_on_core, _analyzer_on_core;
+	for (size_t i = 0; i < parser_thread_vec.size(); i ++) {
+		_parser_on_core.push_back({parser_core_id[i], parser_thread_vec[i].get()});
+	}
+	for (size_t i = 0; i < analyzer_thread_vec.size(); i ++) {
+		_analyzer_on_core.push_back({analyzer_core_id[i], analyzer_thread_vec[i].get()});
+	}
+
 	// start all worker threads, mamory safe
 #ifdef SPLIT_START_SUPPORT_PCPP
-	vector<DpdkWorkerThread *> _thread_vec_all;
-	transform(parser_thread_vec.cbegin(), parser_thread_vec.cend(), back_inserter(_thread_vec_all),
-			[] (decltype(parser_thread_vec)::value_type _p) -> DpdkWorkerThread * {return _p.get(); });
+	vector<DpdkWorkerThread *> _thread_vec_all = _f_by_core(_parser_on_core);
 
 	assert(core_parser.size() == _thread_vec_all.size());
 	if (!DpdkDeviceList::getInstance().startDpdkWorkerThreads(core_mask_parser, _thread_vec_all)) {
 		FATAL_ERROR("Couldn't start parser worker threads");
 	}
 
-	_thread_vec_all.clear();
-	transform(analyzer_thread_vec.cbegin(), analyzer_thread_vec.cend(), back_inserter(_thread_vec_all),
-			[] (decltype(analyzer_thread_vec)::value_type _p) -> DpdkWorkerThread * {return _p.get(); });
+	_thread_vec_all = _f_by_core(_analyzer_on_core);
 
 	assert(core_analyzer.size() == _thread_vec_all.size());
 	if (!DpdkDeviceList::getInstance().startDpdkWorkerThreads(core_mask_analyzer, _thread_vec_all)) {
@@ -410,9 +897,7 @@ void DeviceConfig::do_init() {
 	// #define START_PARSER_ONLY
 	#ifdef START_PARSER_ONLY
 
-		vector<DpdkWorkerThread *> _thread_vec_all;
-		transform(parser_thread_vec.cbegin(), parser_thread_vec.cend(), back_inserter(_thread_vec_all),
-				[] (decltype(parser_thread_vec)::value_type _p) -> DpdkWorkerThread * {return _p.get(); });
+		vector<DpdkWorkerThread *> _thread_vec_all = _f_by_core(_parser_on_core);
 
 		assert(core_parser.size() == _thread_vec_all.size());
 		if (!DpdkDeviceList::getInstance().startDpdkWorkerThreads(core_mask_parser, _thread_vec_all)) {
@@ -421,14 +906,12 @@ void DeviceConfig::do_init() {
 	
 	#else
 
-		vector<DpdkWorkerThread *> _thread_vec_all;
-		transform(parser_thread_vec.cbegin(), parser_thread_vec.cend(), back_inserter(_thread_vec_all),
-				[] (decltype(parser_thread_vec)::value_type _p) -> DpdkWorkerThread * {return _p.get(); });
-		transform(analyzer_thread_vec.cbegin(), analyzer_thread_vec.cend(), back_inserter(_thread_vec_all),
-			[] (decltype(analyzer_thread_vec)::value_type _p) -> DpdkWorkerThread * {return _p.get(); });
+		core_thread_t _all_on_core(_parser_on_core);
+		_all_on_core.insert(_all_on_core.end(), _analyzer_on_core.cbegin(), _analyzer_on_core.cend());
+		vector<DpdkWorkerThread *> _thread_vec_all = _f_by_core(_all_on_core);
 
 		assert(core_parser.size() + core_analyzer.size() == _thread_vec_all.size());
-		if (!DpdkDeviceList::getInstance().startDpdkWorkerThreads(core_without_master, _thread_vec_all)) {
+		if (!DpdkDeviceList::getInstance().startDpdkWorkerThreads(core_mask_parser | core_mask_analyzer, _thread_vec_all)) {
 			FATAL_ERROR("Couldn't start parser worker threads");
 		}
 
@@ -440,8 +923,31 @@ void DeviceConfig::do_init() {
 	ThreadStateManagement args(parser_thread_vec, analyzer_thread_vec);
 	ApplicationEventHandler::getInstance().onApplicationInterrupted(interrupt_callback, &args);
 
+	// the master core runs the queue balancer and the analyzer scaling, each at its own interval
+	const bool is_rebalance = p_configure_param->queue_rebalance;
+	const bool is_scaling = p_configure_param->analyzer_scaling;
+	double_t tick = 5.0;
+	if (is_rebalance) {
+		tick = min(tick, p_configure_param->rebalance_interval);
+	}
+	if (is_scaling) {
+		tick = min(tick, p_configure_param->scale_interval);
+	}
+	double_t last_rebalance = get_time_spec(), last_scale = last_rebalance;
 	while (!args.stop) {
-		multiPlatformSleep(5);
+		usleep((useconds_t) (tick * 1e6));
+		const double_t now = get_time_spec();
+		if (args.stop) {
+			break;
+		}
+		if (is_rebalance && now - last_rebalance >= p_configure_param->rebalance_interval) {
+			rebalance_queues(parser_thread_vec, now - last_rebalance);
+			last_rebalance = now;
+		}
+		if (is_scaling && now - last_scale >= p_configure_param->scale_interval) {
+			scale_analyzers(analyzer_thread_vec);
+			last_scale = now;
+		}
 	}
 }
 
@@ -502,6 +1008,79 @@ auto DeviceConfig::configure_via_json(const json & jin) -> bool {
 			_device_param->core_num = 
 				static_cast<cpu_core_id_t>(dpdk_config["core_num"]);
 		}
+		if (dpdk_config.count("core_placement")) {
+			_device_param->core_placement = 
+				static_cast<decltype(_device_param->core_placement)>(dpdk_config["core_placement"]);
+			if (find(core_placement_list.cbegin(), core_placement_list.cend(), 
+					 _device_param->core_placement) == core_placement_list.cend()) {
+				WARNF("Unknown core placement: %s", _device_param->core_placement.c_str());
+				throw logic_error("Parse error Json tag: core_placement\n");
+			}
+		}
+		if (dpdk_config.count("master_core")) {
+			_device_param->master_core = 
+				static_cast<cpu_core_id_t>(dpdk_config["master_core"]);
+		}
+		if (dpdk_config.count("parser_core_vec")) {
+			_device_param->parser_core_vec = 
+				dpdk_config["parser_core_vec"].get<decltype(_device_param->parser_core_vec)>();
+		}
+		if (dpdk_config.count("analyzer_core_vec")) {
+			_device_param->analyzer_core_vec = 
+				dpdk_config["analyzer_core_vec"].get<decltype(_device_param->analyzer_core_vec)>();
+		}
+		if (dpdk_config.count("queue_rebalance")) {
+			_device_param->queue_rebalance = 
+				static_cast<decltype(_device_param->queue_rebalance)>(dpdk_config["queue_rebalance"]);
+		}
+		if (dpdk_config.count("rebalance_interval")) {
+			_device_param->rebalance_interval = 
+				static_cast<decltype(_device_param->rebalance_interval)>(dpdk_config["rebalance_interval"]);
+			if (_device_param->rebalance_interval <= 0) {
+				WARNF("Invalid rebalance interval: %lf", _device_param->rebalance_interval);
+				throw logic_error("Parse error Json tag: rebalance_interval\n");
+			}
+		}
+		if (dpdk_config.count("rebalance_threshold")) {
+			_device_param->rebalance_threshold = 
+				static_cast<decltype(_device_param->rebalance_threshold)>(dpdk_config["rebalance_threshold"]);
+		}
+		if (dpdk_config.count("analyzer_scaling")) {
+			_device_param->analyzer_scaling = 
+				static_cast<decltype(_device_param->analyzer_scaling)>(dpdk_config["analyzer_scaling"]);
+		}
+		if (dpdk_config.count("scale_interval")) {
+			_device_param->scale_interval = 
+				static_cast<decltype(_device_param->scale_interval)>(dpdk_config["scale_interval"]);
+			if (_device_param->scale_interval <= 0) {
+				WARNF("Invalid scale interval: %lf", _device_param->scale_interval);
+				throw logic_error("Parse error Json tag: scale_interval\n");
+			}
+		}
+		if (dpdk_config.count("scale_up_backlog")) {
+			_device_param->scale_up_backlog = 
+				static_cast<decltype(_device_param->scale_up_backlog)>(dpdk_config["scale_up_backlog"]);
+		}
+		if (dpdk_config.count("scale_down_backlog")) {
+			_device_param->scale_down_backlog = 
+				static_cast<decltype(_device_param->scale_down_backlog)>(dpdk_config["scale_down_backlog"]);
+		}
+		if (dpdk_config.count("min_active_analyzer")) {
+			_device_param->min_active_analyzer = 
+				static_cast<decltype(_device_param->min_active_analyzer)>(dpdk_config["min_active_analyzer"]);
+		}
+		if (dpdk_config.count("pipeline_spectral_core")) {
+			_device_param->pipeline_spectral_core = 
+				static_cast<cpu_core_id_t>(dpdk_config["pipeline_spectral_core"]);
+		}
+		if (dpdk_config.count("pipeline_scoring_core")) {
+			_device_param->pipeline_scoring_core = 
+				static_cast<cpu_core_id_t>(dpdk_config["pipeline_scoring_core"]);
+		}
+		if (dpdk_config.count("pipeline_ring_size")) {
+			_device_param->pipeline_ring_size = 
+				static_cast<size_t>(dpdk_config["pipeline_ring_size"]);
+		}
 
 		if (dpdk_config.count("verbose")) {
 			verbose = dpdk_config["verbose"];
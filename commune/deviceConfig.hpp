@@ -5,6 +5,7 @@
 #include "kMeansLearner.hpp"
 #include "analyzerWorker.hpp"
 #include "dpdkCommon.hpp"
+#include "cpuTopology.hpp"
 
 
 #define DISP_PARAM
@@ -14,6 +15,11 @@ namespace Whisper
 {
 
 
+// Placement of the worker threads: the cores after the master in order, the explicit core lists,
+// or automatic from the /sys topology
+static const vector<string> core_placement_list = {"sequential", "explicit", "auto"};
+
+
 class ParserWorkerThread;
 class AnalyzerWorkerThread;
 class KMeansLearner;
@@ -29,6 +35,32 @@ struct DeviceConfigParam final {
     cpu_core_id_t core_use_for_analyze = 8;
     cpu_core_id_t core_use_for_parser = 8;
     cpu_core_id_t core_num = 17;
+    // Optional pipeline behind the analyzers: cores of the STFT stage and of the scoring stage
+    cpu_core_id_t pipeline_spectral_core = 0;
+    cpu_core_id_t pipeline_scoring_core = 0;
+    size_t pipeline_ring_size = 1024;
+
+    string core_placement = "sequential";
+    // DPDK master core, and the cores of the explicit placement:
+    // one per parser, one per analyzer followed by the pipeline stages
+    cpu_core_id_t master_core = 0;
+    vector<cpu_core_id_t> parser_core_vec;
+    vector<cpu_core_id_t> analyzer_core_vec;
+
+    // Runtime migration of RX queues from the most loaded parser to the least loaded one,
+    // when the most loaded exceeds the mean by the threshold (ratio)
+    bool queue_rebalance = false;
+    double_t rebalance_interval = 5.0;
+    double_t rebalance_threshold = 0.25;
+
+    // Runtime parking and activation of the analyzers, by the buffered share of their lanes:
+    // an analyzer is activated when the most backlogged one exceeds scale_up_backlog,
+    // and one is parked when all stay below scale_down_backlog
+    bool analyzer_scaling = false;
+    double_t scale_interval = 1.0;
+    double_t scale_up_backlog = 0.5;
+    double_t scale_down_backlog = 0.05;
+    size_t min_active_analyzer = 1;
 
     vector<nic_port_id_t> dpdk_port_vec;
 
@@ -48,6 +80,18 @@ struct DeviceConfigParam final {
         
         printf("Num. Core packet parsing: %d, Num. Core analyze: %d. [Sum core used: %d]\n\n"
         , core_use_for_analyze, core_use_for_parser, core_num);
+        printf("Core placement: %s, Master core: %d.\n", core_placement.c_str(), master_core);
+        if (queue_rebalance) {
+            printf("RX queue rebalance: interval %4.2lfs, threshold %4.2lf.\n", rebalance_interval, rebalance_threshold);
+        }
+        if (analyzer_scaling) {
+            printf("Analyzer scaling: interval %4.2lfs, backlog [%4.2lf, %4.2lf], min active %ld.\n", 
+            scale_interval, scale_down_backlog, scale_up_backlog, min_active_analyzer);
+        }
+        if (pipeline_spectral_core != 0) {
+            printf("Num. Core spectral stage: %d, Num. Core scoring stage: %d, Ring size: %ld.\n\n",
+            pipeline_spectral_core, pipeline_scoring_core, pipeline_ring_size);
+        }
     }
 
     DeviceConfigParam() {}
@@ -95,12 +139,24 @@ private:
     auto assign_queue_to_parser(const device_list_t & dev_list, 
 					            const vector<SystemCore> & cores_parser) const -> assign_queue_t;
 
+    // The automatic placement: parsers on the NUMA node of the NICs, one per physical core,
+    // each analyzer on the L3 of its parsers
+    auto plan_core_placement(const device_list_t & dev_list, 
+                             vector<cpu_core_id_t> & parser_cores, 
+                             vector<cpu_core_id_t> & analyzer_cores) const -> bool;
+
     auto create_worker_threads(const assign_queue_t & queue_assign,
                             vector<shared_ptr<ParserWorkerThread> > & parser_thread_vec,
                             vector<shared_ptr<AnalyzerWorkerThread> > & analyzer_thread_vec) -> bool;
 
     static void interrupt_callback(void* cookie);
 
+    // One decision of the queue balancer over the load measured in the last span (s)
+    void rebalance_queues(const vector<shared_ptr<ParserWorkerThread> > & parser_thread_vec, double_t span) const;
+
+    // One decision of the analyzer scaling: activate or park at most one analyzer
+    void scale_analyzers(const vector<shared_ptr<AnalyzerWorkerThread> > & analyzer_thread_vec) const;
+
     json j_cfg_analyzer;
     json j_cfg_kmeans;
     json j_cfg_parser;
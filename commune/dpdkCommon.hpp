@@ -6,8 +6,10 @@
 #include <unistd.h>
 #include <pthread.h>
 #include <semaphore.h>
+#include <poll.h>
 
 #include <sys/stat.h>
+#include <sys/eventfd.h>
 #include <netinet/in.h>
 
 #include <pcapplusplus/Packet.h>
@@ -26,6 +28,10 @@
 #include <pcapplusplus/Logger.h>
 
 #include "../common.hpp"
+#include "packetMeta.hpp"
+
+#include <atomic>
+#include <mutex>
 
 
 using namespace std;
@@ -65,21 +71,41 @@ struct DpdkConfig final {
 };
 
 
-struct PacketMetaData final {
+class ParserWorkerThread;
+
+
+// One RX queue of a NIC, polled by exactly one parser at a time.
+// The counters are written by the polling parser only and read by the queue balancer.
+struct RxQueueState final {
+
+	DpdkDevice * dev;
+	nic_queue_id_t queue_id;
+
+	atomic<uint64_t> pkt_num{0};
+	atomic<uint64_t> poll_num{0};
+	// Polls that received packets, the busy-poll ratio of the queue
+	atomic<uint64_t> busy_poll_num{0};
+	// Parser polling the queue, set by the parser taking it over
+	atomic<ParserWorkerThread *> p_owner;
 
-	uint32_t address;
-	uint16_t proto_code;
-	uint16_t pkt_length;
-	double time_stamp;
+	// Counters at the last decision of the balancer, and the packet rate since then
+	uint64_t seen_pkt_num = 0;
+	uint64_t seen_poll_num = 0;
+	uint64_t seen_busy_poll_num = 0;
+	double_t pkt_rate = 0;
 
-	PacketMetaData() {};
+	RxQueueState(DpdkDevice * d, nic_queue_id_t q, ParserWorkerThread * p): dev(d), queue_id(q), p_owner(p) {}
+	virtual ~RxQueueState() {}
+	RxQueueState & operator=(const RxQueueState &) = delete;
+	RxQueueState(const RxQueueState &) = delete;
 
-	explicit PacketMetaData(uint32_t a, uint16_t t, uint16_t l, double ts):
-			address(a), proto_code(t), pkt_length(l), time_stamp(ts) {}
-	
-	virtual ~PacketMetaData() {};
-    PacketMetaData & operator=(const PacketMetaData &) = default;
-    PacketMetaData(const PacketMetaData &) = default;
+	void inline count(uint16_t n) {
+		poll_num.store(poll_num.load(memory_order_relaxed) + 1, memory_order_relaxed);
+		if (n != 0) {
+			busy_poll_num.store(busy_poll_num.load(memory_order_relaxed) + 1, memory_order_relaxed);
+			pkt_num.store(pkt_num.load(memory_order_relaxed) + n, memory_order_relaxed);
+		}
+	}
 
 };
 
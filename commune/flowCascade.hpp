@@ -0,0 +1,118 @@
+#pragma once
+
+#include "../common.hpp"
+#include "packetMeta.hpp"
+
+
+namespace Whisper
+{
+
+
+// Number of packet length bins of the size entropy, 128 bytes each
+#define CASCADE_LENGTH_BIN 16
+// Number of features of the first stage: log rate, size entropy, log inter-arrival variance
+#define CASCADE_FEATURE 3
+
+
+// Running statistics of one flow since the last decision of the first stage, O(1) per packet
+struct CascadeStat final {
+
+    size_t pkt_num = 0;
+    double_t first_ts = 0;
+    double_t last_ts = 0;
+    // Welford mean and squared deviation of log2 inter-arrival time
+    double_t interval_mean = 0;
+    double_t interval_m2 = 0;
+    uint32_t length_hist[CASCADE_LENGTH_BIN] = {0};
+
+    void update(const PacketMetaData & pkt) {
+        static const double_t min_interval_time = 1e-5;
+        if (pkt_num == 0) {
+            first_ts = pkt.time_stamp;
+        } else {
+            const double_t v = std::log2(std::max(pkt.time_stamp - last_ts, min_interval_time));
+            const double_t d = v - interval_mean;
+            interval_mean += d / pkt_num;
+            interval_m2 += d * (v - interval_mean);
+        }
+        last_ts = pkt.time_stamp;
+        ++ length_hist[std::min((size_t) pkt.pkt_length / 128, (size_t) CASCADE_LENGTH_BIN - 1)];
+        ++ pkt_num;
+    }
+
+    void feature(double_t * p_feature) const {
+        const double_t span = std::max(last_ts - first_ts, 1e-3);
+        p_feature[0] = std::log2(pkt_num / span);
+
+        double_t entropy = 0;
+        for (size_t i = 0; i < CASCADE_LENGTH_BIN; i ++) {
+            if (length_hist[i] != 0) {
+                const double_t p = (double_t) length_hist[i] / pkt_num;
+                entropy -= p * std::log2(p);
+            }
+        }
+        p_feature[1] = entropy;
+
+        const double_t var = pkt_num > 2 ? interval_m2 / (pkt_num - 2) : 0;
+        p_feature[2] = std::log2(var + 1e-6);
+    }
+
+    void reset() {
+        *this = CascadeStat();
+    }
+
+};
+
+
+// Bounds of the first-stage features learned from the flows seen in training:
+// mean +- bound_z standard deviations of each feature
+class CascadeModel final {
+
+private:
+
+    size_t sample_num = 0;
+    double_t mean[CASCADE_FEATURE] = {0};
+    double_t m2[CASCADE_FEATURE] = {0};
+
+public:
+
+    // Minimum number of training flows before the bounds are used
+    #define CASCADE_MIN_SAMPLE 32
+
+    CascadeModel() = default;
+    virtual ~CascadeModel() {}
+    CascadeModel & operator=(const CascadeModel &) = delete;
+    CascadeModel(const CascadeModel &) = delete;
+
+    void learn(const CascadeStat & st) {
+        double_t f[CASCADE_FEATURE];
+        st.feature(f);
+        ++ sample_num;
+        for (size_t i = 0; i < CASCADE_FEATURE; i ++) {
+            const double_t d = f[i] - mean[i];
+            mean[i] += d / sample_num;
+            m2[i] += d * (f[i] - mean[i]);
+        }
+    }
+
+    auto inline ready() const -> bool {
+        return sample_num >= CASCADE_MIN_SAMPLE;
+    }
+
+    // True if any feature of the flow is out of the learned bounds
+    auto is_unusual(const CascadeStat & st, double_t bound_z) const -> bool {
+        double_t f[CASCADE_FEATURE];
+        st.feature(f);
+        for (size_t i = 0; i < CASCADE_FEATURE; i ++) {
+            const double_t std_dev = std::sqrt(m2[i] / (sample_num - 1));
+            if (std::fabs(f[i] - mean[i]) > bound_z * std_dev) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+};
+
+
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#include "../common.hpp"
+#include "slidingDft.hpp"
+#include "seededHash.hpp"
+#include "flowCascade.hpp"
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <tuple>
+#include <memory>
+
+
+namespace Whisper
+{
+
+
+// Spectral state of a flow at one analysis resolution
+struct SpectrumState final {
+
+    // Samples at the front of FlowState::sample_tail already consumed by complete STFT frames
+    size_t sample_offset = 0;
+    // Spectral frames ([frame, freq] row major) not yet consumed by a complete scoring window
+    std::vector<float> frame_tail;
+    // Incremental spectrum in sliding mode, created on the first packet
+    std::unique_ptr<SlidingDft> p_sdft;
+    // Packets since the last score at this resolution
+    size_t pending_pkt_num = 0;
+
+    auto inline frame_num(size_t n_freq) const -> size_t {
+        return frame_tail.size() / n_freq;
+    }
+
+    auto inline memory_size() const -> size_t {
+        return sizeof(SpectrumState) + frame_tail.capacity() * sizeof(float) + 
+               (p_sdft == nullptr ? 0 : p_sdft->memory_size());
+    }
+
+};
+
+
+// Analysis state of one flow, kept across batches
+struct FlowState final {
+
+    uint32_t address = 0;
+    // Length of the prefix aggregated into this flow, 32 for a single host
+    uint8_t prefix_len = 32;
+    // Index of the analysis view, the address is a source or a destination of it
+    uint8_t view = 0;
+
+    // Time stamp of the last packet, negative before the first one
+    double_t last_ts = -1;
+
+    // Encoded packets not yet consumed by a complete STFT frame of all resolutions
+    std::vector<float> sample_tail;
+
+    // One per analysis resolution, all fed by the same encoded packets
+    std::vector<SpectrumState> spectrum;
+
+    // Open analysis epoch, negative for none
+    int64_t epoch_id = -1;
+
+    // Packets of this flow since it entered the table
+    size_t pkt_num = 0;
+
+    // First-stage statistics since its last decision, and the decision
+    CascadeStat cascade_stat;
+    bool cascade_pass = true;
+
+    // Position in the LRU list and memory accounted, maintained by FlowTable
+    std::list<uint32_t>::iterator lru_pos;
+    size_t mem_size = 0;
+
+    FlowState() = default;
+    FlowState(uint32_t a, size_t resolution_num): address(a), spectrum(resolution_num) {}
+    virtual ~FlowState() {}
+    FlowState & operator=(const FlowState &) = delete;
+    FlowState(const FlowState &) = delete;
+
+    // Drop the samples consumed by all resolutions
+    void trim_samples() {
+        size_t consumed = sample_tail.size();
+        for (const auto & sp : spectrum) {
+            consumed = std::min(consumed, sp.sample_offset);
+        }
+        sample_tail.erase(sample_tail.begin(), sample_tail.begin() + consumed);
+        for (auto & sp : spectrum) {
+            sp.sample_offset -= consumed;
+        }
+    }
+
+    void clear_samples() {
+        sample_tail.clear();
+        for (auto & sp : spectrum) {
+            sp.sample_offset = 0;
+        }
+    }
+
+    // Heap footprint of the flow, including its hash node and LRU node
+    auto inline memory_size() const -> size_t {
+        size_t sz = sizeof(FlowState) + 4 * sizeof(void *) + sample_tail.capacity() * sizeof(float);
+        for (const auto & sp : spectrum) {
+            sz += sp.memory_size();
+        }
+        return sz;
+    }
+
+};
+
+
+// Per-analyzer table of flow states, addressed by the aggregation key.
+// Flows are kept in LRU order of their last touch and evicted when idle or when
+// the table exceeds its budget of flows or bytes (0 for unlimited).
+class FlowTable final {
+
+private:
+
+    using table_t = std::unordered_map<uint32_t, FlowState, SeededHash>;
+    table_t table;
+
+    // Least recently touched flow at the front
+    std::list<uint32_t> lru_list;
+
+    size_t max_flow_num;
+    size_t max_mem_size;
+    size_t mem_size = 0;
+    // Number of analysis resolutions of each flow
+    size_t resolution_num;
+
+    void account(FlowState & flow) {
+        const size_t sz = flow.memory_size();
+        mem_size = mem_size - flow.mem_size + sz;
+        flow.mem_size = sz;
+        stat.max_flow_num = std::max(stat.max_flow_num, table.size());
+        stat.max_mem_size = std::max(stat.max_mem_size, mem_size);
+    }
+
+    void erase(FlowState & flow) {
+        mem_size -= flow.mem_size;
+        lru_list.erase(flow.lru_pos);
+        table.erase(flow.address);
+    }
+
+public:
+
+    // Eviction counters and high-water marks
+    struct FlowTableStat {
+        size_t max_flow_num = 0;
+        size_t max_mem_size = 0;
+        size_t evict_idle_num = 0;
+        size_t evict_flow_cap_num = 0;
+        size_t evict_mem_cap_num = 0;
+        // Evicted flows scored by the owner
+        size_t finalize_num = 0;
+    };
+    FlowTableStat stat;
+
+    FlowTable(size_t max_flow, size_t max_mem, size_t res_num = 1): 
+            max_flow_num(max_flow), max_mem_size(max_mem), resolution_num(res_num) {}
+    virtual ~FlowTable() {}
+    FlowTable & operator=(const FlowTable &) = delete;
+    FlowTable(const FlowTable &) = delete;
+
+    auto find_or_insert(uint32_t addr) -> FlowState & {
+        const auto ite = table.emplace(std::piecewise_construct,
+                                       std::forward_as_tuple(addr), std::forward_as_tuple(addr, resolution_num));
+        auto & flow = ite.first->second;
+        if (ite.second) {
+            flow.lru_pos = lru_list.insert(lru_list.end(), addr);
+            account(flow);
+        }
+        return flow;
+    }
+
+    auto find(uint32_t addr) -> FlowState * {
+        const auto ite = table.find(addr);
+        return ite == table.end() ? nullptr : &ite->second;
+    }
+
+    // Mark a flow as the most recently used one and update its memory
+    void touch(FlowState & flow) {
+        lru_list.splice(lru_list.end(), lru_list, flow.lru_pos);
+        account(flow);
+    }
+
+    // Update the memory of a flow changed outside touch(), e.g. after a flush
+    void reaccount(FlowState & flow) {
+        account(flow);
+    }
+
+    // Evict the flows without packets since (now - idle_time), func(flow) finalizes a flow before it is erased.
+    // Checked from the LRU end only, so a flow touched out of time order may stay a bit longer.
+    template<typename F>
+    void evict_idle(double_t now, double_t idle_time, F && func) {
+        while (!lru_list.empty()) {
+            auto & flow = table.at(lru_list.front());
+            if (flow.last_ts + idle_time > now) {
+                break;
+            }
+            ++ stat.evict_idle_num;
+            func(flow);
+            erase(flow);
+        }
+    }
+
+    // Evict the least recently used flows until the table fits its budget.
+    // The most recent flow is always kept.
+    template<typename F>
+    void evict_over_budget(F && func) {
+        while (lru_list.size() > 1) {
+            if (max_flow_num != 0 && table.size() > max_flow_num) {
+                ++ stat.evict_flow_cap_num;
+            } else if (max_mem_size != 0 && mem_size > max_mem_size) {
+                ++ stat.evict_mem_cap_num;
+            } else {
+                break;
+            }
+            auto & flow = table.at(lru_list.front());
+            func(flow);
+            erase(flow);
+        }
+    }
+
+    auto inline size() const -> size_t {
+        return table.size();
+    }
+
+    auto inline memory_size() const -> size_t {
+        return mem_size;
+    }
+
+};
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "../common.hpp"
+
+#include <new>
+#include <cstring>
+#include <sys/mman.h>
+#include <numaif.h>
+
+#include <rte_malloc.h>
+#include <rte_lcore.h>
+
+
+namespace Whisper
+{
+
+
+// Source of the pages of a local array
+enum local_memory_t : uint8_t {
+    MEMORY_RTE_HUGEPAGE = 0,
+    MEMORY_MMAP_HUGEPAGE = 1,
+    MEMORY_MMAP = 2
+};
+
+static const char * const local_memory_name[] = {"DPDK hugepages", "hugepages", "normal pages"};
+
+#define LOCAL_HUGE_PAGE_SIZE (1ul << 21)
+
+
+// NUMA node of the page holding p, -1 if unknown. Checks the placement of a local array
+// against the node of its core, i.e. that its accesses do not cross the sockets.
+static inline auto local_page_node(const void * p) -> int {
+    int node = -1;
+    if (p == nullptr || get_mempolicy(&node, nullptr, 0, const_cast<void *>(p), MPOL_F_NODE | MPOL_F_ADDR) != 0) {
+        return -1;
+    }
+    return node;
+}
+
+
+// Prefer the node of the calling core for the pages of [p, p + size), before they are faulted.
+// Preferred rather than bound, so that a full node falls back to the others instead of failing
+// the fault. The placement is checked by the callers with local_page_node.
+static inline auto prefer_local_pages(void * p, size_t size) -> bool {
+    const int node = (int) rte_socket_id();
+    if (node < 0 || node >= (int) (8 * sizeof(unsigned long))) {
+        return false;
+    }
+    const unsigned long node_mask = 1ul << node;
+    return mbind(p, size, MPOL_PREFERRED, &node_mask, 8 * sizeof(node_mask) + 1, 0) == 0;
+}
+
+
+// Array of n default-constructed T for the calling worker, on the NUMA node of its core.
+// Taken from the DPDK heap of the socket first (hugepages), then from anonymous hugepages,
+// then from normal pages; the mmap fallbacks prefer the node of the core by policy,
+// and the pages are all faulted here by the calling thread before the array is used.
+template<typename T>
+auto make_local_array(size_t n, const char * name, local_memory_t * p_kind = nullptr) -> std::shared_ptr<T[]> {
+    const size_t sz = std::max(n * sizeof(T), (size_t) 1);
+    size_t map_size = 0;
+    local_memory_t kind = MEMORY_RTE_HUGEPAGE;
+    void * p = rte_malloc_socket(name, sz, 64, (int) rte_socket_id());
+    if (p == nullptr) {
+        kind = MEMORY_MMAP_HUGEPAGE;
+        map_size = (sz + LOCAL_HUGE_PAGE_SIZE - 1) & ~(LOCAL_HUGE_PAGE_SIZE - 1);
+        p = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            prefer_local_pages(p, map_size);
+        }
+    }
+    if (p == MAP_FAILED) {
+        kind = MEMORY_MMAP;
+        map_size = sz;
+        p = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            return nullptr;
+        }
+        // transparent hugepages where the kernel allows
+        madvise(p, map_size, MADV_HUGEPAGE);
+        prefer_local_pages(p, map_size);
+    }
+
+    // pre-fault the pages, then construct in place
+    memset(p, 0, sz);
+    T * p_arr = static_cast<T *>(p);
+    for (size_t i = 0; i < n; i ++) {
+        new (p_arr + i) T();
+    }
+    if (p_kind != nullptr) {
+        *p_kind = kind;
+    }
+
+    return std::shared_ptr<T[]>(p_arr, [n, kind, map_size] (T * p_del) -> void {
+        for (size_t i = 0; i < n; i ++) {
+            p_del[i].~T();
+        }
+        if (kind == MEMORY_RTE_HUGEPAGE) {
+            rte_free(p_del);
+        } else {
+            munmap(p_del, map_size);
+        }
+    });
+}
+
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "../common.hpp"
+
+#include <vector>
+#include <limits>
+#include <utility>
+
+
+namespace Whisper
+{
+
+
+// Tournament tree of losers for the k-way merge of sorted runs.
+// Each inner node keeps the run that lost the match at that node, so that replacing the head
+// of the winning run replays only its path to the root: O(log k) per element, no allocation
+// after construction. Equal keys are taken from the run of the lower index first.
+template<typename Key>
+class LoserTree final {
+
+private:
+
+    size_t k;
+    // tree[0] is the winning run, tree[1 .. k - 1] the losers of the inner nodes
+    std::vector<size_t> tree;
+    // Head key of each run
+    std::vector<Key> keys;
+
+    // Run k is virtual, it beats all the runs while the tree is built whatever their keys
+    auto inline beats(size_t a, size_t b) const -> bool {
+        if (a == k || b == k) {
+            return a == k;
+        }
+        return keys[a] < keys[b] || (keys[a] == keys[b] && a < b);
+    }
+
+    void replay(size_t s) {
+        for (size_t t = (s + k) / 2; t > 0; t /= 2) {
+            if (beats(tree[t], s)) {
+                std::swap(s, tree[t]);
+            }
+        }
+        tree[0] = s;
+    }
+
+public:
+
+    // Key of an exhausted run
+    static constexpr Key END_KEY = std::numeric_limits<Key>::max();
+
+    explicit LoserTree(size_t n): k(n), tree(n), keys(n) {}
+    virtual ~LoserTree() {}
+    LoserTree & operator=(const LoserTree &) = delete;
+    LoserTree(const LoserTree &) = delete;
+
+    // Head key of run s, set for every run before build
+    auto inline key(size_t s) -> Key & {
+        return keys[s];
+    }
+
+    void build() {
+        std::fill(tree.begin(), tree.end(), k);
+        for (size_t s = k; s > 0; s --) {
+            replay(s - 1);
+        }
+    }
+
+    // Run of the smallest head key, END_KEY once all runs are exhausted
+    auto inline winner() const -> size_t {
+        return tree[0];
+    }
+
+    auto inline winner_key() const -> Key {
+        return keys[tree[0]];
+    }
+
+    // Advance the winning run to its next key
+    void pop(Key next) {
+        keys[tree[0]] = next;
+        replay(tree[0]);
+    }
+
+    auto inline size() const -> size_t {
+        return k;
+    }
+
+};
+
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "../common.hpp"
+#include "seededHash.hpp"
+
+#include <vector>
+
+
+namespace Whisper
+{
+
+
+// Fixed-memory aggregate series of the sources too short to be analyzed alone.
+// The unscored samples of such a source are appended to the bucket of its prefix
+// (hashed into bucket_num buckets), and a bucket is analyzed like a flow each time
+// its series reaches series_len samples.
+class LowRateSketch final {
+
+public:
+
+    struct Bucket {
+        // Concatenated samples of the folded sources, at most series_len
+        std::vector<float> series;
+        // Prefix of the first source since the last analysis, mixed if another prefix shares the bucket
+        uint32_t prefix = 0;
+        bool mixed = false;
+        size_t pkt_num = 0;
+    };
+
+    // Folded sources and analyzed series
+    size_t fold_num = 0;
+    size_t series_num = 0;
+
+private:
+
+    std::vector<Bucket> buckets;
+    size_t series_len;
+    SeededHash hash;
+
+public:
+
+    LowRateSketch(size_t bucket_num, size_t len): buckets(bucket_num), series_len(len) {
+        for (auto & b : buckets) {
+            b.series.reserve(series_len);
+        }
+    }
+    virtual ~LowRateSketch() {}
+    LowRateSketch & operator=(const LowRateSketch &) = delete;
+    LowRateSketch(const LowRateSketch &) = delete;
+
+    // Fold the samples of one source, func(bucket_index, bucket) analyzes a full series and resets it
+    template<typename F>
+    void fold(uint32_t prefix, const float * p_sample, size_t n, size_t pkt_num, F && func) {
+        const size_t index = hash(prefix) % buckets.size();
+        auto & b = buckets[index];
+        if (b.series.empty() && b.pkt_num == 0) {
+            b.prefix = prefix;
+            b.mixed = false;
+        } else if (b.prefix != prefix) {
+            b.mixed = true;
+        }
+        b.pkt_num += pkt_num;
+        ++ fold_num;
+
+        while (n != 0) {
+            const size_t take = std::min(n, series_len - b.series.size());
+            b.series.insert(b.series.end(), p_sample, p_sample + take);
+            p_sample += take;
+            n -= take;
+            if (b.series.size() == series_len) {
+                func(index, b);
+                ++ series_num;
+                b.series.clear();
+                b.pkt_num = 0;
+                b.prefix = prefix;
+                b.mixed = false;
+            }
+        }
+    }
+
+    auto inline bucket_num() const -> size_t {
+        return buckets.size();
+    }
+
+    auto inline memory_size() const -> size_t {
+        return sizeof(LowRateSketch) + buckets.size() * (sizeof(Bucket) + series_len * sizeof(float));
+    }
+
+};
+
+
+}
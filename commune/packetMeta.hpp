@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../common.hpp"
+
+
+namespace Whisper
+{
+
+
+// Properties of one packet, written by the parsers and read by the analyzers
+struct PacketMetaData final {
+
+	// Source and destination addresses, in network order
+	uint32_t address;
+	uint32_t dst_address;
+	uint16_t proto_code;
+	uint16_t pkt_length;
+	double time_stamp;
+
+	PacketMetaData() {};
+
+	explicit PacketMetaData(uint32_t a, uint32_t d, uint16_t t, uint16_t l, double ts):
+			address(a), dst_address(d), proto_code(t), pkt_length(l), time_stamp(ts) {}
+	
+	virtual ~PacketMetaData() {};
+    PacketMetaData & operator=(const PacketMetaData &) = default;
+    PacketMetaData(const PacketMetaData &) = default;
+
+};
+
+
+}
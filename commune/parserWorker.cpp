@@ -17,12 +17,18 @@ bool ParserWorkerThread::run(uint32_t core_id)
 		return false;
 	}
 
-	meta_pkt_arr = shared_ptr<PacketMetaData[]>(new PacketMetaData[p_parser_config->meta_pkt_arr_size](), 
-													std::default_delete<PacketMetaData[]>());
-
-	if (meta_pkt_arr == nullptr) {
-		FATAL_ERROR("Meta data array: bad allocation.");
+	// on the hugepages of the node of this core, written by this parser only,
+	// the lanes share the buffer size of the parser
+	local_memory_t meta_memory;
+	const size_t lane_capacity = max(p_parser_config->meta_pkt_arr_size / lanes.size(), (size_t) 1);
+	for (const auto & p_lane : lanes) {
+		p_lane->meta_pkt_arr = make_local_array<PacketMetaData>(lane_capacity, "parser_meta", &meta_memory);
+		if (p_lane->meta_pkt_arr == nullptr) {
+			FATAL_ERROR("Meta data array: bad allocation.");
+		}
+		p_lane->capacity.store(lane_capacity, memory_order_release);
 	}
+	const size_t wakeup_threshold = min(p_parser_config->wakeup_threshold, lane_capacity);
 
 	// the size of receive burst, must be smaller than 2 << 16
 	using p_mbuf_t = MBufRawPacket*;
@@ -34,7 +40,16 @@ bool ParserWorkerThread::run(uint32_t core_id)
 	// LOGF("Parser on core # %2d start.", core_id);
 
 	if (p_parser_config->verbose_mode & ParserConfigParam::verbose_type::INIT) {
-		LOGF("Parser on core # %2d start.", core_id);
+		LOGF("Parser on core # %2d start, %ld lanes, packet buffer on %s of node %d (core on node %d).", core_id, 
+			 lanes.size(), local_memory_name[meta_memory], local_page_node(lanes[0]->meta_pkt_arr.get()), 
+			 (int) rte_socket_id());
+	}
+	for (const auto & p_lane : lanes) {
+		const int node = local_page_node(p_lane->meta_pkt_arr.get());
+		if (node >= 0 && node != (int) rte_socket_id()) {
+			WARNF("Parser on core # %2d: packet buffer of lane %ld on node %d, remote to the core on node %d.", 
+				  core_id, p_lane->index, node, (int) rte_socket_id());
+		}
 	}
 	m_stop = false;
 
@@ -50,6 +65,7 @@ bool ParserWorkerThread::run(uint32_t core_id)
 			pcpp::IPv4Layer * IPlay = parsedPacket.getLayerOfType<pcpp::IPv4Layer>();
 
 			uint32_t addr = IPlay->getSrcIPv4Address().toInt();
+			uint32_t dst_addr = IPlay->getDstIPv4Address().toInt();
 			uint16_t length = ntohs(IPlay->getIPv4Header()->totalLength);
 			double_t ts = GET_DOUBLE_TS(packet_arr[i]->getPacketTimeStamp());
 
@@ -74,7 +90,7 @@ bool ParserWorkerThread::run(uint32_t core_id)
 				type_code = type_identify_mp::TYPE_UNKNOWN;
 			}
 			
-			return make_shared<PacketMetaData>(addr, type_code, length, ts);
+			return make_shared<PacketMetaData>(addr, dst_addr, type_code, length, ts);
 			
 		} else {
 			return nullptr;
@@ -85,44 +101,62 @@ bool ParserWorkerThread::run(uint32_t core_id)
 
 	// main loop, runs until be told to stop
 	while (!m_stop) {
-		// go over all DPDK devices configured for this worker/core
-		for (parser_queue_assign_t::iterator iter = p_dpdk_config->nic_queue_list.begin(); 
-			 								 iter != p_dpdk_config->nic_queue_list.end(); 
-											 iter++) {
-			// for each DPDK device go over all RX queues configured for this worker/core
-			for (vector<nic_queue_id_t>::iterator iter2 = iter->second.begin(); 
-									   iter2 != iter->second.end(); 
-									   iter2++) {
-				DpdkDevice* dev = iter->first;
-
-				// receive packets from network on the specified DPDK device and RX queue
-				uint16_t packetsReceived = dev->receivePackets(packet_arr, p_parser_config->max_receive_burts, *iter2);
-				
-				// iterate all of the packets and parse the metadata
-				for (uint16_t i = 0; i < packetsReceived; i++) {
+		// hand over and take over the queues moved by the balancer, between two rounds of polls
+		if (mailbox.has_mail.load(memory_order_acquire)) {
+			handle_mailbox();
+		}
 
-					const auto p_meta = _f_get_meta_pkt_info(i, dev);
-					if (p_meta == nullptr) {
-						continue;
-					}
+		// go over all RX queues polled by this worker/core
+		for (const auto p_queue : rx_queues) {
+			DpdkDevice* dev = p_queue->dev;
 
-					assert(meta_index <= p_parser_config->meta_pkt_arr_size);
-					acquire_semaphore();
-					meta_pkt_arr[meta_index] = *p_meta;
-					meta_index ++;
-					release_semaphore();
-
-					// the array of parsed queue reach its max
-					if (meta_index == p_parser_config->meta_pkt_arr_size) {
-						WARNF("Parser on core # %2d: parse queue reach max.", (int) this->getCoreId());
-						// clear the meta data buffer, just for testing
-											acquire_semaphore();
-						acquire_semaphore();
-						meta_index = 0;
-						release_semaphore();
+			// receive packets from network on the specified DPDK device and RX queue
+			uint16_t packetsReceived = dev->receivePackets(packet_arr, p_parser_config->max_receive_burts, p_queue->queue_id);
+			p_queue->count(packetsReceived);
+			
+			// iterate all of the packets and parse the metadata
+			for (uint16_t i = 0; i < packetsReceived; i++) {
+
+				const auto p_meta = _f_get_meta_pkt_info(i, dev);
+				if (p_meta == nullptr) {
+					continue;
+				}
+
+				const uint32_t lane_address = lane_by_destination ? p_meta->dst_address : p_meta->address;
+				auto & lane = lanes.size() == 1 ? *lanes[0] : 
+							  *lanes[lane_of_bucket[lane_bucket(lane_address)].load(memory_order_relaxed)];
+				assert(lane.meta_index <= lane_capacity);
+				// a full lane drops the new packets until its analyzer fetches, the buffered ones are kept
+				lane.acquire_semaphore();
+				const size_t n_buffered = lane.meta_index;
+				bool is_wakeup = false;
+				if (n_buffered < lane_capacity) {
+					const size_t slot = lane.meta_head + n_buffered;
+					lane.meta_pkt_arr[slot < lane_capacity ? slot : slot - lane_capacity] = *p_meta;
+					lane.meta_index = n_buffered + 1;
+					// once per fetch, a partial fetch may leave the buffer above the threshold
+					if (!lane.is_signalled && n_buffered + 1 >= wakeup_threshold) {
+						lane.is_signalled = true;
+						is_wakeup = true;
 					}
+				}
+				lane.release_semaphore();
+				if (n_buffered == lane_capacity) {
+					++ lane.drop_pkt_num;
+					continue;
+				}
+
+				if (is_wakeup) {
+					lane.signal_analyzer();
+				}
 
+				// the array of parsed queue reach its max
+				if (n_buffered + 1 == lane_capacity) {
+					WARNF("Parser on core # %2d: parse queue of lane %ld reach max, dropping until fetched.", 
+						  (int) this->getCoreId(), lane.index);
+					lane.signal_analyzer();
 				}
+
 			}
 		}
 	}
@@ -138,6 +172,86 @@ bool ParserWorkerThread::run(uint32_t core_id)
 }
 
 
+auto ParserWorkerThread::park_lane(size_t i) -> bool
+{
+	vector<size_t> active;
+	for (const auto & p_lane : lanes) {
+		if (p_lane->is_active && p_lane->index != i) {
+			active.push_back(p_lane->index);
+		}
+	}
+	if (active.empty()) {
+		return false;
+	}
+
+	// the buckets of the lane are spread over the others, the rest keep their lane
+	size_t cursor = 0;
+	for (size_t b = 0; b < LANE_BUCKET_NUM; b ++) {
+		if (lane_of_bucket[b].load(memory_order_relaxed) == i) {
+			lane_of_bucket[b].store(active[cursor ++ % active.size()], memory_order_relaxed);
+		}
+	}
+	lanes[i]->is_active = false;
+	return true;
+}
+
+
+void ParserWorkerThread::activate_lane(size_t i)
+{
+	// the lane takes back its own buckets
+	lanes[i]->is_active = true;
+	for (size_t b = 0; b < LANE_BUCKET_NUM; b ++) {
+		if (b % lanes.size() == i) {
+			lane_of_bucket[b].store(i, memory_order_relaxed);
+		}
+	}
+}
+
+
+void ParserWorkerThread::post_release(RxQueueState * p_queue, ParserWorkerThread * p_target)
+{
+	lock_guard<mutex> guard(mailbox.lock);
+	mailbox.release.push_back({p_queue, p_target});
+	mailbox.has_mail.store(true, memory_order_release);
+}
+
+
+void ParserWorkerThread::post_adopt(RxQueueState * p_queue)
+{
+	lock_guard<mutex> guard(mailbox.lock);
+	mailbox.adopt.push_back(p_queue);
+	mailbox.has_mail.store(true, memory_order_release);
+}
+
+
+void ParserWorkerThread::handle_mailbox()
+{
+	vector<pair<RxQueueState *, ParserWorkerThread *> > handoff;
+	{
+		lock_guard<mutex> guard(mailbox.lock);
+		for (const auto p_queue : mailbox.adopt) {
+			p_queue->p_owner.store(this, memory_order_release);
+			rx_queues.push_back(p_queue);
+		}
+		mailbox.adopt.clear();
+		for (const auto & ref : mailbox.release) {
+			const auto ite = find(rx_queues.begin(), rx_queues.end(), ref.first);
+			if (ite != rx_queues.end()) {
+				rx_queues.erase(ite);
+				handoff.push_back(ref);
+			}
+		}
+		mailbox.release.clear();
+		mailbox.has_mail.store(false, memory_order_relaxed);
+	}
+
+	// not polled by any core until the target takes it, posted without holding this mailbox
+	for (const auto & ref : handoff) {
+		ref.second->post_adopt(ref.first);
+	}
+}
+
+
 void ParserWorkerThread::verbose_tracing_thread() const
 {
 	while (! m_stop) {
@@ -276,6 +390,15 @@ auto ParserWorkerThread::configure_via_json(const json & jin) -> bool
 			}
 		}
 
+		if (jin.count("wakeup_threshold")) {
+			p_parser_config->wakeup_threshold = 
+				static_cast<decltype(p_parser_config->wakeup_threshold)>(jin["wakeup_threshold"]);
+			if (p_parser_config->wakeup_threshold > p_parser_config->meta_pkt_arr_size) {
+				WARNF("Wakeup threshold exceeds the meta data buffer.");
+				throw logic_error("Parse error Json tag: wakeup_threshold\n");
+			}
+		}
+
 		if (jin.count("verbose_mode")) {
 			json _j_mode = jin["verbose_mode"];
 			if (verbose_mode_map.count(_j_mode) != 0) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "dpdkCommon.hpp"
+#include "localBuffer.hpp"
 #include "deviceConfig.hpp"
 #include "analyzerWorker.hpp"
 
@@ -34,6 +35,8 @@ struct ParserConfigParam final {
 	size_t meta_pkt_arr_size = 1000000;
 	#define RECEIVE_BURST_LIM (1 << 16)
 	size_t max_receive_burts = 64;
+	// Wake the analyzer once the buffer holds this many packets, 0 to never signal
+	size_t wakeup_threshold = 4096;
 
 	ParserConfigParam() = default;
     virtual ~ParserConfigParam() {}
@@ -44,8 +47,8 @@ struct ParserConfigParam final {
         printf("[Whisper Parser Configuration]\n");
 
         printf("Memory realated param:\n");
-        printf("Maximum receive burst: %ld, Meta data buffer size: %ld\n",
-        max_receive_burts, meta_pkt_arr_size);
+        printf("Maximum receive burst: %ld, Meta data buffer size: %ld, Wakeup threshold: %ld\n",
+        max_receive_burts, meta_pkt_arr_size, wakeup_threshold);
 
         stringstream ss;
         ss << "Verbose mode: {";
@@ -66,6 +69,58 @@ static const map<string, ParserConfigParam::verbose_type> verbose_mode_map = {
 };
 
 
+// Output of a parser to one analyzer. A parser feeding several analyzers splits the sources
+// over its lanes by address hash, so that the packets of a source stay on one analyzer.
+struct ParserLane final {
+
+	// Collect the per-packets metadata, capacity set once the buffer is allocated
+	shared_ptr<PacketMetaData[]> meta_pkt_arr;
+	atomic<size_t> capacity{0};
+	// The buffer is a ring: meta_index packets are buffered from the offset meta_head on,
+	// the parser appends behind them and the analyzer fetches from the head
+	volatile size_t meta_index = 0;
+	volatile size_t meta_head = 0;
+
+	// Parser writing the lane, and the index of the lane in it
+	ParserWorkerThread * p_parser = nullptr;
+	size_t index = 0;
+	// Receives the sources of the buckets of the lane, false once the analyzer is parked
+	bool is_active = true;
+	// Packets dropped while the buffer was full, written by the parser only
+	size_t drop_pkt_num = 0;
+
+	// Read-Write exclution for per-packet Metadata
+	mutable sem_t semaphore;
+	void inline acquire_semaphore() const {
+		sem_wait(&semaphore);
+	}
+	void inline release_semaphore() const {
+		sem_post(&semaphore);
+	}
+
+	// Eventfd of the bound analyzer, signalled when the buffer passes the wakeup threshold
+	volatile int wakeup_fd = -1;
+	// Signalled since the last fetch, set by the parser and cleared by the analyzer under the semaphore
+	bool is_signalled = false;
+	void inline signal_analyzer() const {
+		const uint64_t one = 1;
+		if (wakeup_fd >= 0) {
+			// fails only when the counter saturates, i.e. the analyzer is signalled already
+			const ssize_t ret = write(wakeup_fd, &one, sizeof(one));
+			(void) ret;
+		}
+	}
+
+	ParserLane(ParserWorkerThread * p, size_t i): p_parser(p), index(i) {
+		sem_init(&semaphore, 0, 1);
+	}
+	virtual ~ParserLane() {}
+	ParserLane & operator=(const ParserLane &) = delete;
+	ParserLane(const ParserLane &) = delete;
+
+};
+
+
 class ParserWorkerThread final : public DpdkWorkerThread {
 
 	friend class AnalyzerWorkerThread;
@@ -90,13 +145,37 @@ private:
 	void verbose_final() const;
 	void verbose_tracing_thread() const;
 
-	// Read-Write exclution for per-packet Metadata
-	mutable sem_t semaphore;
-	void inline acquire_semaphore() const {
-		sem_wait(&semaphore);
+	// Lanes to the analyzers fed by this parser, and the lane of each bucket of addresses,
+	// source addresses or destination addresses as of the analysis view.
+	// The buckets of a parked lane are spread over the active lanes, and taken back on activation.
+	#define LANE_BUCKET_NUM 256
+	vector<shared_ptr<ParserLane> > lanes;
+	atomic<uint8_t> lane_of_bucket[LANE_BUCKET_NUM];
+	bool lane_by_destination = false;
+	static auto inline lane_bucket(uint32_t address) -> size_t {
+		return (address * 2654435761u) >> 24;
 	}
-	void inline release_semaphore() const {
-		sem_post(&semaphore);
+	// Called before the start of the parser
+	void set_lane_num(size_t n) {
+		lanes.clear();
+		for (size_t i = 0; i < n; i ++) {
+			lanes.push_back(make_shared<ParserLane>(this, i));
+		}
+		for (size_t b = 0; b < LANE_BUCKET_NUM; b ++) {
+			lane_of_bucket[b].store(b % n, memory_order_relaxed);
+		}
+	}
+	// Called by the analyzer scaling at runtime, false if no other lane is active
+	auto park_lane(size_t i) -> bool;
+	void activate_lane(size_t i);
+
+	void init_rx_queues() {
+		for (const auto & ref : p_dpdk_config->nic_queue_list) {
+			for (const auto q : ref.second) {
+				rx_queue_state_vec.push_back(make_shared<RxQueueState>(ref.first, q, this));
+				rx_queues.push_back(rx_queue_state_vec.back().get());
+			}
+		}
 	}
 
 	enum type_identify_mp : uint16_t {
@@ -111,14 +190,27 @@ private:
 		TYPE_UNKNOWN 	= 10,
 	};
 
-	// Index of metadata array
-	volatile size_t meta_index = 0;
+	// RX queues of this parser as assigned at startup, and the queues it polls now.
+	// The polled list is changed by this parser only, between two rounds of polls.
+	vector<shared_ptr<RxQueueState> > rx_queue_state_vec;
+	vector<RxQueueState *> rx_queues;
+
+	// Mailbox of the queue balancer. Handoff: the balancer posts a release to the current parser,
+	// which stops polling the queue and posts it to the adoption of the target parser,
+	// so that a queue is never polled by two cores.
+	struct QueueMailbox {
+		mutex lock;
+		vector<pair<RxQueueState *, ParserWorkerThread *> > release;
+		vector<RxQueueState *> adopt;
+		atomic<bool> has_mail{false};
+	};
+	QueueMailbox mailbox;
+	void post_release(RxQueueState * p_queue, ParserWorkerThread * p_target);
+	void post_adopt(RxQueueState * p_queue);
+	void handle_mailbox();
 
 public:
 
-	// Collect the per-packets metadata
-	shared_ptr<PacketMetaData[]> meta_pkt_arr;
-
 	ParserWorkerThread(const shared_ptr<DpdkConfig> p_d, const json & j_p): 
 					p_dpdk_config(p_d), m_core_id(p_d != nullptr ? p_d->core_id : MAX_NUM_OF_CORES + 1) {
 		
@@ -126,7 +218,7 @@ public:
 			FATAL_ERROR("NULL dpdk configuration for parser.");
 		}
 
-		sem_init(&semaphore, 0, 1);
+		set_lane_num(1);
 
 		if (j_p.size()) {
 			configure_via_json(j_p);
@@ -136,6 +228,7 @@ public:
 		sum_parsed_pkt_len.resize(p_d->nic_queue_list.size(), 0);
 		parsed_pkt_len.resize(p_d->nic_queue_list.size(), 0);
 		parsed_pkt_num.resize(p_d->nic_queue_list.size(), 0);
+		init_rx_queues();
     }
 
 	ParserWorkerThread(const shared_ptr<DpdkConfig> p_d = nullptr, 
@@ -147,12 +240,13 @@ public:
 			FATAL_ERROR("dpdk configuration not found for parser.");
 		}
 
-		sem_init(&semaphore, 0, 1);
+		set_lane_num(1);
 
 		sum_parsed_pkt_num.resize(p_d->nic_queue_list.size(), 0);
 		sum_parsed_pkt_len.resize(p_d->nic_queue_list.size(), 0);
 		parsed_pkt_len.resize(p_d->nic_queue_list.size(), 0);
 		parsed_pkt_num.resize(p_d->nic_queue_list.size(), 0);
+		init_rx_queues();
 	}
 
 	virtual ~ParserWorkerThread() {}
@@ -177,6 +271,12 @@ public:
 				parsed_pkt_len[index] = 0;
 				index ++;
 		}
+		for (const auto & p_lane : lanes) {
+			if (p_lane->drop_pkt_num != 0) {
+				WARNF("Parser on core # %d: %ld packets dropped on the full lane %ld.", 
+					  getCoreId(), p_lane->drop_pkt_num, p_lane->index);
+			}
+		}
 		verbose_final();
 	}
 
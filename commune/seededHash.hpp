@@ -0,0 +1,70 @@
+#pragma once
+
+#include "../common.hpp"
+
+#include <random>
+
+
+namespace Whisper
+{
+
+
+// SipHash-2-4 of a 64-bit key under a random 128-bit seed, for the hash tables keyed by
+// addresses that an attacker controls. The seed differs per table and per run, so colliding
+// addresses can not be precomputed.
+class SeededHash final {
+
+private:
+
+    uint64_t k0, k1;
+
+    auto static inline rotl(uint64_t x, int b) -> uint64_t {
+        return (x << b) | (x >> (64 - b));
+    }
+
+    auto static inline sip_round(uint64_t & v0, uint64_t & v1, uint64_t & v2, uint64_t & v3) -> void {
+        v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+        v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+        v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+        v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+    }
+
+public:
+
+    SeededHash() {
+        std::random_device rd;
+        k0 = ((uint64_t) rd() << 32) | rd();
+        k1 = ((uint64_t) rd() << 32) | rd();
+    }
+
+    SeededHash(uint64_t _k0, uint64_t _k1): k0(_k0), k1(_k1) {}
+
+    auto operator()(uint64_t m) const -> size_t {
+        uint64_t v0 = k0 ^ 0x736f6d6570736575ull;
+        uint64_t v1 = k1 ^ 0x646f72616e646f6dull;
+        uint64_t v2 = k0 ^ 0x6c7967656e657261ull;
+        uint64_t v3 = k1 ^ 0x7465646279746573ull;
+
+        v3 ^= m;
+        sip_round(v0, v1, v2, v3);
+        sip_round(v0, v1, v2, v3);
+        v0 ^= m;
+
+        // the last block holds the message length (8 bytes) only
+        const uint64_t b = 8ull << 56;
+        v3 ^= b;
+        sip_round(v0, v1, v2, v3);
+        sip_round(v0, v1, v2, v3);
+        v0 ^= b;
+
+        v2 ^= 0xff;
+        for (int i = 0; i < 4; i ++) {
+            sip_round(v0, v1, v2, v3);
+        }
+        return (size_t) (v0 ^ v1 ^ v2 ^ v3);
+    }
+
+};
+
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "../common.hpp"
+
+#include <vector>
+#include <complex>
+
+
+namespace Whisper
+{
+
+
+// Recompute the bins directly every such number of updates to bound the rounding drift
+#define SDFT_RESYNC_INTERVAL (1 << 12)
+
+
+// Sliding DFT over the last n_fft samples of a flow, updated in O(n_fft / 2 + 1) per sample.
+// Frames are due at the same sample positions as torch::stft without padding,
+// i.e. once the first n_fft samples arrived and every hop samples after that.
+class SlidingDft final {
+
+private:
+
+    using complex_t = std::complex<double_t>;
+
+    size_t n_fft;
+    size_t hop;
+
+    // Bins 0 .. n_fft / 2 of the spectrum of the last n_fft samples
+    std::vector<complex_t> bins;
+    // The last n_fft samples, ring_pos is the oldest one
+    std::vector<double_t> ring;
+    size_t ring_pos = 0;
+
+    size_t sample_num = 0;
+    size_t update_since_sync = 0;
+
+    void resync() {
+        const double_t w = 2 * M_PI / n_fft;
+        for (size_t k = 0; k < bins.size(); k ++) {
+            complex_t acc = 0;
+            for (size_t m = 0; m < n_fft; m ++) {
+                acc += ring[(ring_pos + m) % n_fft] * std::polar(1.0, - w * k * m);
+            }
+            bins[k] = acc;
+        }
+        update_since_sync = 0;
+    }
+
+    // Bin j of the full spectrum, by conjugate symmetry beyond n_fft / 2
+    auto inline full_bin(long j) const -> complex_t {
+        if (j < 0) {
+            return std::conj(full_bin(-j));
+        }
+        if ((size_t) j >= bins.size()) {
+            return std::conj(bins[n_fft - j]);
+        }
+        return bins[j];
+    }
+
+public:
+
+    // Twiddle factors exp(2 pi j k / n_fft) of the bins, shared by all flows of an analyzer
+    static auto make_twiddle(size_t n_fft) -> std::vector<complex_t> {
+        std::vector<complex_t> twiddle(n_fft / 2 + 1);
+        for (size_t k = 0; k < twiddle.size(); k ++) {
+            twiddle[k] = std::polar(1.0, 2 * M_PI * k / n_fft);
+        }
+        return twiddle;
+    }
+
+    SlidingDft(size_t n, size_t h): n_fft(n), hop(h), bins(n / 2 + 1), ring(n, 0) {}
+    virtual ~SlidingDft() {}
+    SlidingDft & operator=(const SlidingDft &) = delete;
+    SlidingDft(const SlidingDft &) = delete;
+
+    // Slide in one sample, return true when a frame is due
+    auto push(double_t x, const complex_t * p_twiddle) -> bool {
+        const double_t delta = x - ring[ring_pos];
+        ring[ring_pos] = x;
+        ring_pos = ring_pos + 1 == n_fft ? 0 : ring_pos + 1;
+        for (size_t k = 0; k < bins.size(); k ++) {
+            bins[k] = (bins[k] + delta) * p_twiddle[k];
+        }
+
+        ++ sample_num;
+        if (++ update_since_sync == SDFT_RESYNC_INTERVAL) {
+            resync();
+        }
+        return sample_num >= n_fft && (sample_num - n_fft) % hop == 0;
+    }
+
+    auto inline memory_size() const -> size_t {
+        return sizeof(SlidingDft) + bins.capacity() * sizeof(complex_t) + ring.capacity() * sizeof(double_t);
+    }
+
+    // Current frame as interleaved (real, imag) per bin, i.e. the [n_freq, 1, 2] layout of the STFT.
+    // The window w[m] = a0 - 2 a1 cos(2 pi m / n_fft) is applied in the frequency domain
+    // (rect: a0 = 1, a1 = 0; hann: 0.5, 0.25; hamming: 0.54, 0.23).
+    void frame(double_t a0, double_t a1, float * p_out) const {
+        for (size_t k = 0; k < bins.size(); k ++) {
+            complex_t v = bins[k];
+            if (a1 != 0) {
+                v = a0 * v - a1 * (full_bin((long) k - 1) + full_bin((long) k + 1));
+            }
+            p_out[2 * k] = (float) v.real();
+            p_out[2 * k + 1] = (float) v.imag();
+        }
+    }
+
+};
+
+
+}
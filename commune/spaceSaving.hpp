@@ -0,0 +1,121 @@
+#pragma once
+
+#include "../common.hpp"
+#include "seededHash.hpp"
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+
+namespace Whisper
+{
+
+
+// Space-Saving summary of the heaviest keys of a stream, with capacity counters.
+// A key seen in the stream is always counted: the smallest counter is taken over when the
+// summary is full, and its count becomes the error bound of the new key.
+// The counters are kept in a min-heap, so an update is O(log capacity).
+template<typename Key>
+class SpaceSaving final {
+
+public:
+
+    struct Counter {
+        Key key;
+        uint64_t count;
+        // Upper bound of the over-estimation of count
+        uint64_t error;
+    };
+
+private:
+
+    size_t capacity;
+    std::vector<Counter> heap;
+    std::unordered_map<Key, size_t, SeededHash> position;
+
+    void swap_node(size_t i, size_t j) {
+        std::swap(heap[i], heap[j]);
+        position[heap[i].key] = i;
+        position[heap[j].key] = j;
+    }
+
+    void sift_up(size_t i) {
+        while (i != 0 && heap[(i - 1) / 2].count > heap[i].count) {
+            swap_node(i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+    }
+
+    void sift_down(size_t i) {
+        while (true) {
+            size_t m = i;
+            const size_t l = 2 * i + 1, r = 2 * i + 2;
+            if (l < heap.size() && heap[l].count < heap[m].count) m = l;
+            if (r < heap.size() && heap[r].count < heap[m].count) m = r;
+            if (m == i) {
+                return;
+            }
+            swap_node(i, m);
+            i = m;
+        }
+    }
+
+public:
+
+    explicit SpaceSaving(size_t cap): capacity(cap) {
+        heap.reserve(capacity);
+        position.reserve(capacity);
+    }
+    virtual ~SpaceSaving() {}
+    SpaceSaving & operator=(const SpaceSaving &) = delete;
+    SpaceSaving(const SpaceSaving &) = delete;
+
+    void update(const Key & key, uint64_t weight = 1) {
+        const auto ite = position.find(key);
+        if (ite != position.end()) {
+            heap[ite->second].count += weight;
+            sift_down(ite->second);
+        } else if (heap.size() < capacity) {
+            heap.push_back({key, weight, 0});
+            position[key] = heap.size() - 1;
+            sift_up(heap.size() - 1);
+        } else {
+            // take over the smallest counter
+            auto & root = heap[0];
+            position.erase(root.key);
+            root = {key, root.count + weight, root.count};
+            position[key] = 0;
+            sift_down(0);
+        }
+    }
+
+    // Halve all counters, so that the summary follows the recent part of the stream.
+    // The heap order is kept, since halving is monotone.
+    void decay() {
+        for (auto & c : heap) {
+            c.count >>= 1;
+            c.error >>= 1;
+        }
+    }
+
+    // The k heaviest keys, in descending order of the guaranteed count (count - error)
+    auto top(size_t k) const -> std::vector<Counter> {
+        std::vector<Counter> res(heap);
+        k = std::min(k, res.size());
+        std::partial_sort(res.begin(), res.begin() + k, res.end(),
+                          [] (const Counter & a, const Counter & b) -> bool {
+            return a.count - a.error > b.count - b.error;
+        });
+        res.resize(k);
+        return res;
+    }
+
+    auto inline size() const -> size_t {
+        return heap.size();
+    }
+
+};
+
+
+}
@@ -0,0 +1,233 @@
+#include "spectralKernel.hpp"
+
+
+using namespace std;
+using namespace Whisper;
+
+
+// Valid names of instruction set
+const vector<string> Whisper::spectral_kernel_isa_list = {"auto", "scalar", "avx2"};
+
+
+// Portable kernels, the bodies in kernel_impl
+static const SpectralKernel scalar_kernel = {
+    "scalar",
+    kernel_impl::encode_packets,
+    kernel_impl::power_log_scrub,
+    kernel_impl::max_min_center_dist
+};
+
+
+#if defined(__x86_64__)
+#define X86_KERNEL_DISPATCH
+
+#include <immintrin.h>
+
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+
+
+// log2 of 8 positive normal floats, by the exponent and the Cephes logf polynomial of the mantissa
+// (relative error about 1e-7). NaN and Inf lanes are set to 0, as std::isfinite in the scalar kernel.
+AVX2_TARGET static inline auto avx2_log2_scrub(__m256 v) -> __m256
+{
+    const __m256i bits = _mm256_castps_si256(v);
+    const __m256i exp_mask = _mm256_set1_epi32(0x7f800000);
+    const __m256 is_finite = _mm256_castsi256_ps(
+        _mm256_xor_si256(_mm256_cmpeq_epi32(_mm256_and_si256(bits, exp_mask), exp_mask), _mm256_set1_epi32(-1)));
+
+    // v = m * 2^e with m in [0.5, 1)
+    __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+    __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)), 
+                                                   _mm256_set1_epi32(0x3f000000)));
+    // m in [sqrt(0.5), sqrt(2)), x = m - 1
+    const __m256 is_low = _mm256_cmp_ps(m, _mm256_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+    e = _mm256_sub_ps(e, _mm256_and_ps(is_low, _mm256_set1_ps(1.0f)));
+    const __m256 x = _mm256_sub_ps(_mm256_add_ps(m, _mm256_and_ps(is_low, m)), _mm256_set1_ps(1.0f));
+
+    const __m256 z = _mm256_mul_ps(x, x);
+    __m256 y = _mm256_set1_ps(7.0376836292e-2f);
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(-1.1514610310e-1f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.1676998740e-1f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(-1.2420140846e-1f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.4249322787e-1f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(-1.6668057665e-1f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(2.0000714765e-1f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(-2.4999993993e-1f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(3.3333331174e-1f));
+    y = _mm256_mul_ps(_mm256_mul_ps(y, x), z);
+    y = _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, y);
+
+    // log2(v) = e + (x + y) * log2(e)
+    const __m256 res = _mm256_fmadd_ps(_mm256_add_ps(x, y), _mm256_set1_ps(1.44269504088896341f), e);
+    return _mm256_and_ps(res, is_finite);
+}
+
+
+// 8 packets per step: the fields of the scattered packets and the intervals are taken as in the
+// scalar kernel, the log2 of the intervals (at least min_interval_time, so normal floats) is vectorized.
+// The result differs from the scalar kernel by at most one float rounding.
+AVX2_TARGET static void avx2_encode_packets(const PacketMetaData * p_raw, const size_t * p_index, 
+                                            size_t n, double_t prev_ts, float * p_out)
+{
+    static const double_t min_interval_time = 1e-5;
+    alignas(32) float interval_buf[8];
+    alignas(32) float base_buf[8];
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        for (size_t k = 0; k < 8; k ++) {
+            const PacketMetaData & info = p_raw[p_index[i + k]];
+            double_t interval = prev_ts < 0 ? min_interval_time : info.time_stamp - prev_ts;
+            if (interval <= 0) {
+                interval = min_interval_time;
+            }
+            prev_ts = info.time_stamp;
+            interval_buf[k] = (float) interval;
+            base_buf[k] = (float) (info.pkt_length * 10 + info.proto_code / 10);
+        }
+        const __m256 lg = avx2_log2_scrub(_mm256_load_ps(interval_buf));
+        _mm256_storeu_ps(p_out + i, _mm256_fnmadd_ps(lg, _mm256_set1_ps(15.68f), _mm256_load_ps(base_buf)));
+    }
+    kernel_impl::encode_packets(p_raw, p_index + i, n - i, prev_ts, p_out + i);
+}
+
+
+// 8 frames of a frequency per step: the interleaved (real, imag) pairs are squared and added
+// pairwise, then the 64-bit halves are put back in the frame order
+AVX2_TARGET static void avx2_power_log_scrub(const float * p_spec, size_t n_freq, size_t n_frame, float * p_out)
+{
+    alignas(32) float buf[8];
+    const __m256 one = _mm256_set1_ps(1.0f);
+    for (size_t t0 = 0; t0 < n_frame; t0 += SPECTRAL_TILE_FRAME) {
+        const size_t t1 = std::min(n_frame, t0 + SPECTRAL_TILE_FRAME);
+        for (size_t f = 0; f < n_freq; f ++) {
+            const float * p_row = p_spec + (f * n_frame) * 2;
+            size_t t = t0;
+            for (; t + 8 <= t1; t += 8) {
+                const __m256 a = _mm256_loadu_ps(p_row + 2 * t);
+                const __m256 b = _mm256_loadu_ps(p_row + 2 * t + 8);
+                const __m256 pw = _mm256_hadd_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b));
+                const __m256 ordered = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(pw), 0xd8));
+                _mm256_store_ps(buf, avx2_log2_scrub(_mm256_add_ps(ordered, one)));
+                for (size_t k = 0; k < 8; k ++) {
+                    p_out[(t + k) * n_freq + f] = buf[k];
+                }
+            }
+            for (; t < t1; t ++) {
+                const float re = p_row[2 * t];
+                const float im = p_row[2 * t + 1];
+                const float v = std::log2(re * re + im * im + 1.0f);
+                p_out[t * n_freq + f] = std::isfinite(v) ? v : 0.0f;
+            }
+        }
+    }
+}
+
+
+// Norm of the window and the nearest center, 4 doubles per step
+AVX2_TARGET static auto avx2_max_min_center_dist(const float * p_win, const float * p_dot, 
+                                                 const float * p_center_norm, size_t n_win, 
+                                                 size_t n_dim, size_t n_center, 
+                                                 double_t alert_bound) -> double_t
+{
+    const double_t alert_bound_sq = alert_bound * alert_bound;
+    double_t max_dist_sq = 0;
+    alignas(32) double_t buf[4];
+    for (size_t i = 0; i < n_win; i ++) {
+        const float * p_x = p_win + i * n_dim;
+        __m256d acc = _mm256_setzero_pd();
+        size_t k = 0;
+        for (; k + 4 <= n_dim; k += 4) {
+            const __m256d x = _mm256_cvtps_pd(_mm_loadu_ps(p_x + k));
+            acc = _mm256_fmadd_pd(x, x, acc);
+        }
+        _mm256_store_pd(buf, acc);
+        double_t x_norm = (buf[0] + buf[1]) + (buf[2] + buf[3]);
+        for (; k < n_dim; k ++) {
+            x_norm += (double_t) p_x[k] * p_x[k];
+        }
+
+        const float * p_d = p_dot + i * n_center;
+        double_t min_dist_sq = std::numeric_limits<double_t>::max();
+        size_t j = 0;
+        if (n_center >= 4) {
+            const __m256d xn = _mm256_set1_pd(x_norm);
+            const __m256d m2 = _mm256_set1_pd(-2.0);
+            __m256d dmin = _mm256_set1_pd(min_dist_sq);
+            for (; j + 4 <= n_center; j += 4) {
+                const __m256d d = _mm256_add_pd(_mm256_fmadd_pd(m2, _mm256_cvtps_pd(_mm_loadu_ps(p_d + j)), xn), 
+                                                _mm256_cvtps_pd(_mm_loadu_ps(p_center_norm + j)));
+                dmin = _mm256_min_pd(dmin, d);
+            }
+            _mm256_store_pd(buf, dmin);
+            min_dist_sq = std::min(std::min(buf[0], buf[1]), std::min(buf[2], buf[3]));
+        }
+        for (; j < n_center; j ++) {
+            const double_t d = x_norm - 2.0 * p_d[j] + p_center_norm[j];
+            min_dist_sq = std::min(min_dist_sq, d);
+        }
+        // the expansion may be slightly negative due to rounding
+        min_dist_sq = std::max(min_dist_sq, 0.0);
+        max_dist_sq = std::max(max_dist_sq, min_dist_sq);
+
+        if (alert_bound > 0 && max_dist_sq > alert_bound_sq) {
+            break;
+        }
+    }
+    return std::sqrt(max_dist_sq);
+}
+
+
+// Haswell and later
+static const SpectralKernel avx2_kernel = {
+    "avx2",
+    avx2_encode_packets,
+    avx2_power_log_scrub,
+    avx2_max_min_center_dist
+};
+#endif
+
+
+static auto __is_cpu_support(const string & isa) -> bool 
+{
+    if (isa == "scalar") {
+        return true;
+    }
+#ifdef X86_KERNEL_DISPATCH
+    __builtin_cpu_init();
+    if (isa == "avx2") {
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    }
+#endif
+    return false;
+}
+
+
+auto Whisper::select_spectral_kernel(const string & isa) -> const SpectralKernel *
+{
+#ifdef X86_KERNEL_DISPATCH
+    static const vector<pair<string, const SpectralKernel *> > kernel_by_priority = {
+        {"avx2", &avx2_kernel}, 
+        {"scalar", &scalar_kernel}
+    };
+#else
+    static const vector<pair<string, const SpectralKernel *> > kernel_by_priority = {
+        {"scalar", &scalar_kernel}
+    };
+#endif
+
+    if (isa != "auto") {
+        for (const auto & ref: kernel_by_priority) {
+            if (ref.first == isa && __is_cpu_support(ref.first)) {
+                return ref.second;
+            }
+        }
+        WARNF("Kernel instruction set %s is not supported by this CPU, use auto.", isa.c_str());
+    }
+
+    for (const auto & ref: kernel_by_priority) {
+        if (__is_cpu_support(ref.first)) {
+            return ref.second;
+        }
+    }
+    return &scalar_kernel;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "../common.hpp"
+#include "packetMeta.hpp"
+
+#include <limits>
+#include <vector>
+#include <string>
+
+
+namespace Whisper
+{
+
+
+// Number of STFT frames processed as one tile by the fused kernel
+#define SPECTRAL_TILE_FRAME 16
+
+// The portable kernel bodies, the vector variants are in spectralKernel.cpp
+#define KERNEL_INLINE static inline
+
+
+namespace kernel_impl
+{
+
+
+// Packet encoding of one flow, 2020.12.8 weight transform.
+// Time intervals are taken between consecutive packets of p_index, the first one from prev_ts
+// (negative prev_ts for none). Non-positive intervals are clamped to min_interval_time.
+KERNEL_INLINE void encode_packets(const PacketMetaData * p_raw, const size_t * p_index, size_t n, 
+                                  double_t prev_ts, float * p_out)
+{
+    static const double_t min_interval_time = 1e-5;
+    for (size_t i = 0; i < n; i ++) {
+        const PacketMetaData & info = p_raw[p_index[i]];
+        double_t interval = prev_ts < 0 ? min_interval_time : info.time_stamp - prev_ts;
+        if (interval <= 0) {
+            interval = min_interval_time;
+        }
+        prev_ts = info.time_stamp;
+        p_out[i] = info.pkt_length * 10 + info.proto_code / 10 + -std::log2(interval) * 15.68;
+    }
+}
+
+
+// Fused spectral post-processing on the real-valued STFT output.
+// Input: [n_freq, n_frame, 2] (real, imag), contiguous.
+// Output: [n_frame, n_freq], log2(real^2 + imag^2 + 1), with NaN / Inf replaced by 0.
+// The complex spectrum is read exactly once, the output is written tile by tile to stay in L1.
+KERNEL_INLINE void power_log_scrub(const float * p_spec, size_t n_freq, size_t n_frame, float * p_out)
+{
+    for (size_t t0 = 0; t0 < n_frame; t0 += SPECTRAL_TILE_FRAME) {
+        const size_t t1 = std::min(n_frame, t0 + SPECTRAL_TILE_FRAME);
+        for (size_t f = 0; f < n_freq; f ++) {
+            const float * p_row = p_spec + (f * n_frame) * 2;
+            for (size_t t = t0; t < t1; t ++) {
+                const float re = p_row[2 * t];
+                const float im = p_row[2 * t + 1];
+                const float v = std::log2(re * re + im * im + 1.0f);
+                p_out[t * n_freq + f] = std::isfinite(v) ? v : 0.0f;
+            }
+        }
+    }
+}
+
+
+// Max over windows of the distance from each window to its nearest cluster center.
+// p_win: [n_win, n_dim] window means, p_dot: [n_win, n_center] = p_win * centers^T (one GEMM),
+// p_center_norm: [n_center] squared norms of the centers, cached when the centers are loaded.
+// The distance is expanded as |x|^2 - 2x.c + |c|^2, so no per center tensor is created.
+// With a positive alert_bound, stop at the first window whose distance exceeds it:
+// the flow is abnormal anyway and the returned value is a lower bound of the full result.
+KERNEL_INLINE auto max_min_center_dist(const float * p_win, const float * p_dot, const float * p_center_norm,
+                                       size_t n_win, size_t n_dim, size_t n_center, 
+                                       double_t alert_bound) -> double_t
+{
+    const double_t alert_bound_sq = alert_bound * alert_bound;
+    double_t max_dist_sq = 0;
+    for (size_t i = 0; i < n_win; i ++) {
+        const float * p_x = p_win + i * n_dim;
+        double_t x_norm = 0;
+        for (size_t k = 0; k < n_dim; k ++) {
+            x_norm += (double_t) p_x[k] * p_x[k];
+        }
+
+        const float * p_d = p_dot + i * n_center;
+        double_t min_dist_sq = std::numeric_limits<double_t>::max();
+        for (size_t j = 0; j < n_center; j ++) {
+            const double_t d = x_norm - 2.0 * p_d[j] + p_center_norm[j];
+            min_dist_sq = std::min(min_dist_sq, d);
+        }
+        // the expansion may be slightly negative due to rounding
+        min_dist_sq = std::max(min_dist_sq, 0.0);
+        max_dist_sq = std::max(max_dist_sq, min_dist_sq);
+
+        if (alert_bound > 0 && max_dist_sq > alert_bound_sq) {
+            break;
+        }
+    }
+    return std::sqrt(max_dist_sq);
+}
+
+
+}
+
+
+// One set of analyzer kernels compiled for a specific instruction set
+struct SpectralKernel final {
+    const char * isa_name;
+
+    void (* encode_packets)(const PacketMetaData *, const size_t *, size_t, double_t, float *);
+    void (* power_log_scrub)(const float *, size_t, size_t, float *);
+    double_t (* max_min_center_dist)(const float *, const float *, const float *, 
+                                     size_t, size_t, size_t, double_t);
+};
+
+// Valid names of instruction set
+extern const std::vector<std::string> spectral_kernel_isa_list;
+
+// Pick the kernel set by CPUID ("auto"), or force one for benchmark.
+// An instruction set unsupported by the CPU falls back to the best supported one.
+auto select_spectral_kernel(const std::string & isa) -> const SpectralKernel *;
+
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "../common.hpp"
+
+#include <vector>
+#include <atomic>
+#include <utility>
+
+
+namespace Whisper
+{
+
+
+// Bounded lock-free ring between exactly one producer thread and one consumer thread.
+// The capacity is rounded up to a power of two. The producer keeps the high-water depth
+// as the gauge of a stage that can not keep up.
+template<typename T>
+class SpscRing final {
+
+private:
+
+    std::vector<T> buffer;
+    size_t mask;
+
+    // Consumer and producer positions on separate cache lines
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+    std::atomic<size_t> high_water{0};
+
+public:
+
+    explicit SpscRing(size_t cap) {
+        size_t n = 1;
+        while (n < cap) {
+            n <<= 1;
+        }
+        buffer.resize(n);
+        mask = n - 1;
+    }
+    virtual ~SpscRing() {}
+    SpscRing & operator=(const SpscRing &) = delete;
+    SpscRing(const SpscRing &) = delete;
+
+    // Producer side, false if the ring is full
+    auto push(T && item) -> bool {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        const size_t depth = t - head.load(std::memory_order_acquire);
+        if (depth == buffer.size()) {
+            return false;
+        }
+        buffer[t & mask] = std::move(item);
+        tail.store(t + 1, std::memory_order_release);
+        if (depth + 1 > high_water.load(std::memory_order_relaxed)) {
+            high_water.store(depth + 1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Consumer side, false if the ring is empty
+    auto pop(T & item) -> bool {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(buffer[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Current depth, exact on either side and approximate elsewhere
+    auto inline size() const -> size_t {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    auto inline capacity() const -> size_t {
+        return buffer.size();
+    }
+
+    // Maximum depth seen by the producer
+    auto inline max_size() const -> size_t {
+        return high_water.load(std::memory_order_relaxed);
+    }
+
+};
+
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "../common.hpp"
+
+#include <vector>
+#include <utility>
+
+
+namespace Whisper
+{
+
+
+// Hierarchical timer wheel: TIMER_WHEEL_LEVEL levels of TIMER_WHEEL_SLOT slots, level l has a
+// resolution of TIMER_WHEEL_SLOT^l ticks. Scheduling is O(1), an entry is cascaded at most
+// once per level. Entries are never cancelled: the owner checks whether a fired entry is stale.
+// An empty wheel jumps to the tick of the next advance, so the owner advances it to its current
+// time before scheduling, and an idle period is never walked tick by tick.
+#define TIMER_WHEEL_BIT 6
+#define TIMER_WHEEL_SLOT (1 << TIMER_WHEEL_BIT)
+#define TIMER_WHEEL_LEVEL 4
+
+template<typename Key>
+class HierarchicalTimerWheel final {
+
+private:
+
+    using tick_t = uint64_t;
+    using entry_t = std::pair<Key, tick_t>;
+
+    std::vector<entry_t> wheel[TIMER_WHEEL_LEVEL][TIMER_WHEEL_SLOT];
+
+    tick_t current_tick = 0;
+    size_t entry_num = 0;
+
+    void insert(const entry_t & e) {
+        const tick_t delta = e.second - current_tick;
+        size_t level = 0;
+        while (level + 1 < TIMER_WHEEL_LEVEL && delta >= ((tick_t) 1 << (TIMER_WHEEL_BIT * (level + 1)))) {
+            ++ level;
+        }
+        // beyond the range of the wheel, fire at the last slot of the top level
+        const tick_t expire = level + 1 == TIMER_WHEEL_LEVEL &&
+                delta >= ((tick_t) 1 << (TIMER_WHEEL_BIT * TIMER_WHEEL_LEVEL)) ?
+                current_tick + ((tick_t) 1 << (TIMER_WHEEL_BIT * TIMER_WHEEL_LEVEL)) - 1 : e.second;
+        const size_t slot = (expire >> (TIMER_WHEEL_BIT * level)) & (TIMER_WHEEL_SLOT - 1);
+        wheel[level][slot].push_back(e);
+    }
+
+    // move the entries of a slot at higher level to the lower levels
+    void cascade(size_t level) {
+        const size_t slot = (current_tick >> (TIMER_WHEEL_BIT * level)) & (TIMER_WHEEL_SLOT - 1);
+        std::vector<entry_t> ve;
+        ve.swap(wheel[level][slot]);
+        for (const auto & e : ve) {
+            insert(e);
+        }
+    }
+
+public:
+
+    HierarchicalTimerWheel() = default;
+    virtual ~HierarchicalTimerWheel() {}
+    HierarchicalTimerWheel & operator=(const HierarchicalTimerWheel &) = delete;
+    HierarchicalTimerWheel(const HierarchicalTimerWheel &) = delete;
+
+    // Fire func(key, tick) at the given tick, or on the next advance if it already passed
+    void schedule(const Key & key, tick_t tick) {
+        insert({key, std::max(tick, current_tick + 1)});
+        ++ entry_num;
+    }
+
+    // Move the wheel to now_tick and fire all entries expired on the way
+    template<typename F>
+    void advance(tick_t now_tick, F && func) {
+        while (current_tick < now_tick) {
+            if (entry_num == 0) {
+                current_tick = now_tick;
+                return;
+            }
+            ++ current_tick;
+            for (size_t level = 1; level < TIMER_WHEEL_LEVEL; level ++) {
+                if ((current_tick & (((tick_t) 1 << (TIMER_WHEEL_BIT * level)) - 1)) != 0) {
+                    break;
+                }
+                cascade(level);
+            }
+
+            auto & slot = wheel[0][current_tick & (TIMER_WHEEL_SLOT - 1)];
+            std::vector<entry_t> ve;
+            ve.swap(slot);
+            entry_num -= ve.size();
+            for (const auto & e : ve) {
+                func(e.first, e.second);
+            }
+        }
+    }
+
+    auto inline size() const -> size_t {
+        return entry_num;
+    }
+
+};
+
+
+}
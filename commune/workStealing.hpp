@@ -0,0 +1,66 @@
+#pragma once
+
+#include "../common.hpp"
+
+#include <deque>
+#include <mutex>
+
+
+namespace Whisper
+{
+
+
+// Double-ended task queue of one worker: the owner pushes and pops at the bottom,
+// idle workers steal from the top, i.e. the oldest tasks of the owner.
+// Guarded by a mutex, tasks are coarse (a flow of a batch) so the lock is rarely contended.
+template<typename Task>
+class WorkStealingDeque final {
+
+private:
+
+    std::deque<Task> tasks;
+    mutable std::mutex lock;
+
+public:
+
+    WorkStealingDeque() = default;
+    virtual ~WorkStealingDeque() {}
+    WorkStealingDeque & operator=(const WorkStealingDeque &) = delete;
+    WorkStealingDeque(const WorkStealingDeque &) = delete;
+
+    void push(const Task & task) {
+        std::lock_guard<std::mutex> guard(lock);
+        tasks.push_back(task);
+    }
+
+    // Owner side, the newest task
+    auto pop(Task & task) -> bool {
+        std::lock_guard<std::mutex> guard(lock);
+        if (tasks.empty()) {
+            return false;
+        }
+        task = tasks.back();
+        tasks.pop_back();
+        return true;
+    }
+
+    // Thief side, the oldest task
+    auto steal(Task & task) -> bool {
+        std::lock_guard<std::mutex> guard(lock);
+        if (tasks.empty()) {
+            return false;
+        }
+        task = tasks.front();
+        tasks.pop_front();
+        return true;
+    }
+
+    auto size() const -> size_t {
+        std::lock_guard<std::mutex> guard(lock);
+        return tasks.size();
+    }
+
+};
+
+
+}
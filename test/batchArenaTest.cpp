@@ -0,0 +1,98 @@
+#include "testCheck.hpp"
+#include "../commune/batchArena.hpp"
+
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+using namespace Whisper;
+
+
+static auto in_block(const void * p, const void * p_begin, size_t n) -> bool
+{
+    return (const char *) p >= (const char *) p_begin && (const char *) p < (const char *) p_begin + n;
+}
+
+
+static void test_linear_and_aligned()
+{
+    BatchArena arena(1000);
+    CHECK(arena.capacity() == 1024);
+
+    const auto p_begin = arena.allocate(1);
+    const auto p_int = arena.allocate_array<uint32_t>(10);
+    CHECK((uintptr_t) p_int % ARENA_ALIGN == 0);
+    CHECK(in_block(p_int, p_begin, arena.capacity()));
+    const auto p_double = static_cast<double_t *>(arena.allocate(sizeof(double_t) * 4, alignof(double_t)));
+    CHECK((uintptr_t) p_double % alignof(double_t) == 0);
+    CHECK((char *) p_double >= (char *) (p_int + 10));
+    CHECK(arena.batch_stat.alloc_num == 3);
+    CHECK(arena.batch_stat.overflow_num == 0);
+
+    // the whole block is handed out again after a reset
+    arena.reset();
+    CHECK(arena.allocate(1) == p_begin);
+    CHECK(arena.batch_stat.alloc_num == 1);
+}
+
+
+static void test_overflow_and_grow()
+{
+    BatchArena arena(256);
+    const auto p_begin = arena.allocate(200);
+    // beyond the block, served by the heap and still usable
+    const auto p_over = static_cast<char *>(arena.allocate(300));
+    CHECK(!in_block(p_over, p_begin, arena.capacity()));
+    CHECK((uintptr_t) p_over % ARENA_ALIGN == 0);
+    memset(p_over, 1, 300);
+    CHECK(arena.batch_stat.overflow_num == 1);
+    CHECK(arena.batch_stat.overflow_size == 300);
+
+    // the block grows past the footprint of the batch, which then fits in it
+    arena.reset();
+    CHECK(arena.high_water == 500);
+    CHECK(arena.capacity() >= 500);
+    CHECK(arena.batch_stat.overflow_num == 0);
+    const auto p_new = arena.allocate(200);
+    const auto p_next = arena.allocate(300);
+    CHECK(in_block(p_next, p_new, arena.capacity()));
+    CHECK(arena.batch_stat.overflow_num == 0);
+
+    // a batch without overflow keeps the block
+    const size_t cap = arena.capacity();
+    arena.reset();
+    CHECK(arena.capacity() == cap);
+    // the footprint in the block includes the alignment padding
+    CHECK(arena.high_water >= 500 && arena.high_water <= cap);
+}
+
+
+static void test_allocator()
+{
+    BatchArena arena(64);
+    {
+        vector<size_t, ArenaAllocator<size_t> > ve{ArenaAllocator<size_t>(&arena)};
+        for (size_t i = 0; i < 1000; i ++) {
+            ve.push_back(i);
+        }
+        for (size_t i = 0; i < 1000; i ++) {
+            CHECK(ve[i] == i);
+        }
+        CHECK(arena.batch_stat.overflow_num != 0);
+    }
+    CHECK(ArenaAllocator<int>(&arena) == ArenaAllocator<double_t>(&arena));
+    BatchArena other(64);
+    CHECK(ArenaAllocator<int>(&arena) != ArenaAllocator<int>(&other));
+    arena.reset();
+    CHECK(arena.capacity() > 64);
+}
+
+
+int main()
+{
+    test_linear_and_aligned();
+    test_overflow_and_grow();
+    test_allocator();
+    LOGF("BatchArena tests passed.");
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include "testCheck.hpp"
+#include "../commune/flowTable.hpp"
+
+#include <vector>
+
+using namespace std;
+using namespace Whisper;
+
+
+static void test_find_or_insert()
+{
+    FlowTable table(0, 0, 3);
+    CHECK(table.find(1) == nullptr);
+    auto & flow = table.find_or_insert(1);
+    CHECK(flow.address == 1);
+    CHECK(flow.spectrum.size() == 3);
+    CHECK(flow.epoch_id == -1);
+    flow.pkt_num = 5;
+
+    // the state is kept, and stays at its place while other flows come in
+    for (uint32_t a = 2; a < 1000; a ++) {
+        table.find_or_insert(a);
+    }
+    CHECK(&table.find_or_insert(1) == &flow);
+    CHECK(table.find(1) == &flow);
+    CHECK(flow.pkt_num == 5);
+    CHECK(table.size() == 999);
+}
+
+
+static void test_samples()
+{
+    FlowState flow(1, 2);
+    flow.sample_tail = {0, 1, 2, 3, 4, 5};
+    flow.spectrum[0].sample_offset = 4;
+    flow.spectrum[1].sample_offset = 2;
+    // only the samples consumed by all resolutions are dropped
+    flow.trim_samples();
+    CHECK(flow.sample_tail == vector<float>({2, 3, 4, 5}));
+    CHECK(flow.spectrum[0].sample_offset == 2);
+    CHECK(flow.spectrum[1].sample_offset == 0);
+
+    flow.clear_samples();
+    CHECK(flow.sample_tail.empty());
+    CHECK(flow.spectrum[0].sample_offset == 0);
+}
+
+
+static void test_idle_in_lru_order()
+{
+    FlowTable table(0, 0);
+    for (uint32_t a = 1; a <= 4; a ++) {
+        auto & flow = table.find_or_insert(a);
+        flow.last_ts = a;
+        table.touch(flow);
+    }
+    // flow 1 is active again, now the most recent one
+    auto & flow_1 = *table.find(1);
+    flow_1.last_ts = 10;
+    table.touch(flow_1);
+
+    vector<uint32_t> evicted;
+    const auto func = [&] (FlowState & flow) { evicted.push_back(flow.address); };
+    table.evict_idle(10, 7.5, func);
+    CHECK(evicted == vector<uint32_t>({2}));
+    table.evict_idle(20, 7.5, func);
+    CHECK(evicted == vector<uint32_t>({2, 3, 4, 1}));
+    CHECK(table.size() == 0);
+    CHECK(table.memory_size() == 0);
+    CHECK(table.stat.evict_idle_num == 4);
+}
+
+
+static void test_budget()
+{
+    vector<uint32_t> evicted;
+    const auto func = [&] (FlowState & flow) { evicted.push_back(flow.address); };
+
+    // by flow count, the least recently touched first
+    FlowTable count_table(3, 0);
+    for (uint32_t a = 1; a <= 5; a ++) {
+        count_table.touch(count_table.find_or_insert(a));
+        count_table.evict_over_budget(func);
+    }
+    CHECK(evicted == vector<uint32_t>({1, 2}));
+    CHECK(count_table.size() == 3);
+    CHECK(count_table.stat.evict_flow_cap_num == 2);
+    CHECK(count_table.stat.max_flow_num == 4);
+
+    // by bytes, the most recent flow is kept even alone over the budget
+    evicted.clear();
+    const size_t flow_size = FlowState(0, 1).memory_size();
+    FlowTable mem_table(0, 3 * flow_size);
+    for (uint32_t a = 1; a <= 3; a ++) {
+        mem_table.touch(mem_table.find_or_insert(a));
+    }
+    mem_table.evict_over_budget(func);
+    CHECK(evicted.empty());
+    auto & big = mem_table.find_or_insert(4);
+    big.sample_tail.resize(10 * flow_size);
+    mem_table.touch(big);
+    mem_table.evict_over_budget(func);
+    CHECK(evicted == vector<uint32_t>({1, 2, 3}));
+    CHECK(mem_table.size() == 1);
+    CHECK(mem_table.stat.evict_mem_cap_num == 3);
+}
+
+
+static void test_reaccount()
+{
+    // the bytes of a flow changed outside touch() are counted once re-accounted
+    FlowTable table(0, 0);
+    auto & flow = table.find_or_insert(1);
+    const size_t base = table.memory_size();
+    CHECK(base == flow.memory_size());
+
+    flow.sample_tail.resize(1000);
+    CHECK(table.memory_size() == base);
+    table.reaccount(flow);
+    CHECK(table.memory_size() == flow.memory_size());
+    CHECK(table.memory_size() >= base + 1000 * sizeof(float));
+    CHECK(table.stat.max_mem_size == table.memory_size());
+
+    flow.sample_tail.clear();
+    flow.sample_tail.shrink_to_fit();
+    table.reaccount(flow);
+    CHECK(table.memory_size() == base);
+
+    // the table total stays the sum of its flows through evictions
+    auto & other = table.find_or_insert(2);
+    other.last_ts = 100;
+    table.touch(other);
+    table.evict_idle(50, 10, [] (FlowState &) {});
+    CHECK(table.size() == 1);
+    CHECK(table.memory_size() == other.memory_size());
+}
+
+
+int main()
+{
+    test_find_or_insert();
+    test_samples();
+    test_idle_in_lru_order();
+    test_budget();
+    test_reaccount();
+    LOGF("FlowTable tests passed.");
+    return 0;
+}
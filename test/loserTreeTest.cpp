@@ -0,0 +1,122 @@
+#include "testCheck.hpp"
+#include "../commune/loserTree.hpp"
+
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace Whisper;
+
+
+// Merge the runs as the analyzer merges the lanes: (key, run) of each element in output order
+template<typename Key>
+static auto merge_runs(const vector<vector<Key> > & runs) -> vector<pair<Key, size_t> >
+{
+    LoserTree<Key> tree(runs.size());
+    vector<size_t> head(runs.size(), 0);
+    size_t total = 0;
+    for (size_t s = 0; s < runs.size(); s ++) {
+        tree.key(s) = runs[s].empty() ? tree.END_KEY : runs[s][0];
+        total += runs[s].size();
+    }
+    tree.build();
+
+    vector<pair<Key, size_t> > out;
+    for (size_t i = 0; i < total; i ++) {
+        const size_t s = tree.winner();
+        out.push_back({tree.winner_key(), s});
+        const size_t j = ++ head[s];
+        tree.pop(j < runs[s].size() ? runs[s][j] : tree.END_KEY);
+    }
+    CHECK(tree.winner_key() == tree.END_KEY);
+    return out;
+}
+
+
+// The expected order: by key, equal keys by the lower run
+template<typename Key>
+static auto reference_merge(const vector<vector<Key> > & runs) -> vector<pair<Key, size_t> >
+{
+    vector<pair<Key, size_t> > out;
+    for (size_t s = 0; s < runs.size(); s ++) {
+        for (const auto v : runs[s]) {
+            out.push_back({v, s});
+        }
+    }
+    stable_sort(out.begin(), out.end());
+    return out;
+}
+
+
+static void test_random_runs()
+{
+    mt19937 rng(7);
+    uniform_int_distribution<int> key_dist(0, 50);
+    uniform_int_distribution<size_t> len_dist(0, 40);
+    for (const size_t k : {1, 2, 3, 5, 8, 13, 64}) {
+        for (size_t round = 0; round < 20; round ++) {
+            vector<vector<double_t> > runs(k);
+            for (auto & run : runs) {
+                run.resize(len_dist(rng));
+                for (auto & v : run) {
+                    v = key_dist(rng) * 0.5;
+                }
+                sort(run.begin(), run.end());
+            }
+            CHECK(merge_runs(runs) == reference_merge(runs));
+        }
+    }
+}
+
+
+static void test_equal_keys()
+{
+    // the same time stamps on every lane are taken lane by lane
+    const vector<vector<uint64_t> > runs = {{1, 1, 2}, {1, 2}, {}, {0, 1, 2, 2}};
+    const auto out = merge_runs(runs);
+    const vector<pair<uint64_t, size_t> > expect = {
+        {0, 3}, {1, 0}, {1, 0}, {1, 1}, {1, 3}, {2, 0}, {2, 1}, {2, 3}, {2, 3}
+    };
+    CHECK(out == expect);
+}
+
+
+static void test_empty_runs()
+{
+    LoserTree<double_t> tree(4);
+    for (size_t s = 0; s < tree.size(); s ++) {
+        tree.key(s) = tree.END_KEY;
+    }
+    tree.build();
+    CHECK(tree.winner_key() == tree.END_KEY);
+
+    // one non-empty run among exhausted ones
+    const vector<vector<double_t> > runs = {{}, {}, {0.5, 1.5, 2.5}, {}};
+    CHECK(merge_runs(runs) == reference_merge(runs));
+}
+
+
+static void test_rebuild()
+{
+    // the tree is built again for each batch
+    LoserTree<uint64_t> tree(3);
+    for (size_t batch = 0; batch < 3; batch ++) {
+        for (size_t s = 0; s < tree.size(); s ++) {
+            tree.key(s) = 10 * batch + (tree.size() - s);
+        }
+        tree.build();
+        CHECK(tree.winner() == tree.size() - 1);
+        CHECK(tree.winner_key() == 10 * batch + 1);
+    }
+}
+
+
+int main()
+{
+    test_random_runs();
+    test_equal_keys();
+    test_empty_runs();
+    test_rebuild();
+    LOGF("LoserTree tests passed.");
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "testCheck.hpp"
+#include "../commune/lowRateSketch.hpp"
+
+#include <vector>
+#include <numeric>
+
+using namespace std;
+using namespace Whisper;
+
+
+struct Analyzed {
+    size_t index;
+    vector<float> series;
+    uint32_t prefix;
+    bool mixed;
+    size_t pkt_num;
+};
+
+
+static auto record(vector<Analyzed> & out) -> decltype(auto)
+{
+    return [&out] (size_t index, const LowRateSketch::Bucket & b) -> void {
+        out.push_back({index, b.series, b.prefix, b.mixed, b.pkt_num});
+    };
+}
+
+
+// Sources of one prefix are concatenated, and analyzed once series_len samples are folded
+static void test_concatenate()
+{
+    LowRateSketch sketch(16, 8);
+    vector<Analyzed> out;
+    vector<float> s(8);
+    iota(s.begin(), s.end(), 0.f);
+
+    sketch.fold(0x0a000000, s.data(), 3, 4, record(out));
+    sketch.fold(0x0a000000, s.data() + 3, 4, 5, record(out));
+    CHECK(out.empty());
+    sketch.fold(0x0a000000, s.data() + 7, 1, 2, record(out));
+    CHECK(out.size() == 1);
+    CHECK(out[0].series == s);
+    CHECK(out[0].index < sketch.bucket_num());
+    CHECK(out[0].prefix == 0x0a000000 && !out[0].mixed);
+    CHECK(out[0].pkt_num == 11);
+    CHECK(sketch.fold_num == 3 && sketch.series_num == 1);
+}
+
+
+// A source longer than the rest of the series spills into the next series of the bucket,
+// possibly several
+static void test_spill()
+{
+    LowRateSketch sketch(4, 5);
+    vector<Analyzed> out;
+    vector<float> s(23);
+    iota(s.begin(), s.end(), 1.f);
+
+    sketch.fold(7, s.data(), 3, 3, record(out));
+    sketch.fold(7, s.data() + 3, 20, 20, record(out));
+    CHECK(out.size() == 4);
+    for (size_t i = 0; i < out.size(); i ++) {
+        CHECK(out[i].series == vector<float>(s.begin() + 5 * i, s.begin() + 5 * (i + 1)));
+        CHECK(out[i].index == out[0].index);
+    }
+    // the packets of a source are counted with the series it started
+    CHECK(out[0].pkt_num == 23);
+    CHECK(out[1].pkt_num == 0);
+    CHECK(sketch.fold_num == 2 && sketch.series_num == 4);
+
+    // the spilled 3 samples are completed by the next source
+    sketch.fold(7, s.data(), 2, 2, record(out));
+    CHECK(out.size() == 5);
+    CHECK(out[4].series == vector<float>({21, 22, 23, 1, 2}));
+    CHECK(out[4].pkt_num == 2);
+}
+
+
+// With a single bucket every prefix shares it, a series of two prefixes is mixed,
+// and the flag is reset with the series
+static void test_mixed()
+{
+    LowRateSketch sketch(1, 4);
+    vector<Analyzed> out;
+    const vector<float> s(4, 1.f);
+
+    sketch.fold(1, s.data(), 2, 2, record(out));
+    sketch.fold(2, s.data(), 2, 2, record(out));
+    CHECK(out.size() == 1);
+    CHECK(out[0].index == 0 && out[0].prefix == 1 && out[0].mixed);
+
+    sketch.fold(3, s.data(), 4, 4, record(out));
+    CHECK(out.size() == 2);
+    CHECK(out[1].prefix == 3 && !out[1].mixed);
+
+    // a source spilling over an analysis starts the next series under its prefix
+    sketch.fold(4, s.data(), 3, 3, record(out));
+    sketch.fold(5, s.data(), 3, 3, record(out));
+    CHECK(out.size() == 3 && out[2].mixed);
+    sketch.fold(5, s.data(), 2, 2, record(out));
+    CHECK(out.size() == 4);
+    CHECK(out[3].prefix == 5 && !out[3].mixed);
+}
+
+
+// The memory is fixed by the bucket number and the series length
+static void test_memory()
+{
+    LowRateSketch sketch(64, 32);
+    const size_t mem = sketch.memory_size();
+    CHECK(mem >= 64 * 32 * sizeof(float));
+    vector<float> s(1000, 1.f);
+    for (uint32_t p = 0; p < 10000; p ++) {
+        sketch.fold(p, s.data(), p % 1000, 1, [] (size_t, const LowRateSketch::Bucket & b) -> void {
+            CHECK(b.series.size() == 32);
+        });
+    }
+    CHECK(sketch.memory_size() == mem);
+    CHECK(sketch.fold_num == 10000);
+}
+
+
+int main()
+{
+    test_concatenate();
+    test_spill();
+    test_mixed();
+    test_memory();
+    LOGF("LowRateSketch tests passed.");
+    return 0;
+}
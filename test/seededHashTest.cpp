@@ -0,0 +1,110 @@
+#include "testCheck.hpp"
+#include "../commune/seededHash.hpp"
+
+#include <random>
+#include <vector>
+#include <cstring>
+
+using namespace std;
+using namespace Whisper;
+
+
+// Byte-wise SipHash-2-4 of any message length, written after the reference implementation
+// to check the 64-bit specialization of SeededHash against
+static auto reference_siphash(const uint8_t * p_key, const uint8_t * p_msg, size_t n) -> uint64_t
+{
+    const auto load = [] (const uint8_t * p, size_t len) -> uint64_t {
+        uint64_t v = 0;
+        for (size_t i = 0; i < len; i ++) {
+            v |= (uint64_t) p[i] << (8 * i);
+        }
+        return v;
+    };
+    const auto rotl = [] (uint64_t x, int b) -> uint64_t {
+        return (x << b) | (x >> (64 - b));
+    };
+    const uint64_t k0 = load(p_key, 8), k1 = load(p_key + 8, 8);
+    uint64_t v[4] = {k0 ^ 0x736f6d6570736575ull, k1 ^ 0x646f72616e646f6dull,
+                     k0 ^ 0x6c7967656e657261ull, k1 ^ 0x7465646279746573ull};
+    const auto round = [&] () -> void {
+        v[0] += v[1]; v[1] = rotl(v[1], 13); v[1] ^= v[0]; v[0] = rotl(v[0], 32);
+        v[2] += v[3]; v[3] = rotl(v[3], 16); v[3] ^= v[2];
+        v[0] += v[3]; v[3] = rotl(v[3], 21); v[3] ^= v[0];
+        v[2] += v[1]; v[1] = rotl(v[1], 17); v[1] ^= v[2]; v[2] = rotl(v[2], 32);
+    };
+    const size_t full = n / 8 * 8;
+    for (size_t i = 0; i < full; i += 8) {
+        const uint64_t m = load(p_msg + i, 8);
+        v[3] ^= m;
+        round(); round();
+        v[0] ^= m;
+    }
+    const uint64_t b = ((uint64_t) (n & 0xff) << 56) | load(p_msg + full, n - full);
+    v[3] ^= b;
+    round(); round();
+    v[0] ^= b;
+    v[2] ^= 0xff;
+    round(); round(); round(); round();
+    return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+
+// The vectors of the SipHash paper: key 00 .. 0f, message 00 .. (len - 1)
+static void test_reference_vectors()
+{
+    uint8_t key[16], msg[16];
+    for (int i = 0; i < 16; i ++) {
+        key[i] = msg[i] = (uint8_t) i;
+    }
+    // the 15-byte example of the paper, appendix A
+    CHECK(reference_siphash(key, msg, 15) == 0xa129ca6149be45e5ull);
+    // the 8-byte vector, the only length SeededHash hashes
+    CHECK(reference_siphash(key, msg, 8) == 0x93f5f5799a932462ull);
+
+    const SeededHash hash(0x0706050403020100ull, 0x0f0e0d0c0b0a0908ull);
+    CHECK(hash(0x0706050403020100ull) == 0x93f5f5799a932462ull);
+}
+
+
+// Random keys and messages against the byte-wise implementation
+static void test_random_against_reference()
+{
+    mt19937_64 rng(35);
+    for (int t = 0; t < 10000; t ++) {
+        const uint64_t k0 = rng(), k1 = rng(), m = rng();
+        uint8_t key[16], msg[8];
+        for (int i = 0; i < 8; i ++) {
+            key[i] = (uint8_t) (k0 >> (8 * i));
+            key[8 + i] = (uint8_t) (k1 >> (8 * i));
+            msg[i] = (uint8_t) (m >> (8 * i));
+        }
+        const SeededHash hash(k0, k1);
+        CHECK(hash(m) == reference_siphash(key, msg, 8));
+    }
+}
+
+
+// Different seeds spread the same addresses differently, the random seeds differ per table
+static void test_seeds()
+{
+    const SeededHash a(1, 2), b(1, 3), c(2, 2);
+    size_t same_ab = 0, same_ac = 0;
+    for (uint64_t addr = 0xc0a80000ull; addr < 0xc0a80000ull + 1024; addr ++) {
+        same_ab += a(addr) == b(addr);
+        same_ac += a(addr) == c(addr);
+    }
+    CHECK(same_ab == 0 && same_ac == 0);
+
+    const SeededHash r1, r2;
+    CHECK(r1(0xc0a80001ull) != r2(0xc0a80001ull));
+}
+
+
+int main()
+{
+    test_reference_vectors();
+    test_random_against_reference();
+    test_seeds();
+    LOGF("SeededHash tests passed.");
+    return 0;
+}
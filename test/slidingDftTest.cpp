@@ -0,0 +1,78 @@
+#include "testCheck.hpp"
+#include "../commune/slidingDft.hpp"
+
+#include <random>
+#include <vector>
+#include <complex>
+
+using namespace std;
+using namespace Whisper;
+
+
+// Direct DFT of p_x[0 .. n_fft) under the window a0 - 2 a1 cos(2 pi m / n_fft), bins 0 .. n_fft / 2
+static auto direct_dft(const double_t * p_x, size_t n_fft, double_t a0, double_t a1) -> vector<complex<double_t> >
+{
+    vector<complex<double_t> > bins(n_fft / 2 + 1);
+    for (size_t k = 0; k < bins.size(); k ++) {
+        for (size_t m = 0; m < n_fft; m ++) {
+            const double_t w = a0 - 2 * a1 * cos(2 * M_PI * m / n_fft);
+            bins[k] += p_x[m] * w * polar(1.0, - 2 * M_PI * k * m / n_fft);
+        }
+    }
+    return bins;
+}
+
+
+// Every frame of the sliding DFT against the direct DFT of the same samples, as torch::stft
+// without padding: one frame once n_fft samples arrived and every hop samples after
+static void check_frames(size_t n_fft, size_t hop, size_t n_sample, double_t a0, double_t a1)
+{
+    mt19937 rng(n_fft * 131 + hop);
+    // the encoded packets are in the order of 1e4
+    uniform_real_distribution<double_t> x_dist(0, 2e4);
+    vector<double_t> x(n_sample);
+    for (auto & v : x) {
+        v = x_dist(rng);
+    }
+
+    const auto twiddle = SlidingDft::make_twiddle(n_fft);
+    SlidingDft sdft(n_fft, hop);
+    vector<float> frame(2 * (n_fft / 2 + 1));
+    size_t n_frame = 0;
+    for (size_t i = 0; i < n_sample; i ++) {
+        if (!sdft.push(x[i], twiddle.data())) {
+            continue;
+        }
+        CHECK(i + 1 >= n_fft && (i + 1 - n_fft) % hop == 0);
+        ++ n_frame;
+
+        sdft.frame(a0, a1, frame.data());
+        const auto ref = direct_dft(x.data() + i + 1 - n_fft, n_fft, a0, a1);
+        // relative to the DC bin of the unwindowed frame, the scale of all bins
+        const double_t scale = 2e4 * n_fft;
+        for (size_t k = 0; k < ref.size(); k ++) {
+            CHECK(fabs(frame[2 * k] - ref[k].real()) <= 1e-6 * scale);
+            CHECK(fabs(frame[2 * k + 1] - ref[k].imag()) <= 1e-6 * scale);
+        }
+    }
+    CHECK(n_frame == (n_sample >= n_fft ? (n_sample - n_fft) / hop + 1 : 0));
+}
+
+
+int main()
+{
+    const vector<pair<double_t, double_t> > windows = {{1, 0}, {0.5, 0.25}, {0.54, 0.23}};
+    for (const auto & win : windows) {
+        for (const size_t n_fft : {4, 9, 16, 50}) {
+            for (const size_t hop : {(size_t) 1, max(n_fft / 4, (size_t) 1), n_fft}) {
+                check_frames(n_fft, hop, 3 * n_fft + 5, win.first, win.second);
+            }
+        }
+        // fewer samples than one frame
+        check_frames(16, 4, 10, win.first, win.second);
+    }
+    // long enough for the periodic resync to run several times
+    check_frames(16, 16, 3 * SDFT_RESYNC_INTERVAL + 7, 0.5, 0.25);
+    LOGF("SlidingDft tests passed.");
+    return 0;
+}
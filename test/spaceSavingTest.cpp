@@ -0,0 +1,129 @@
+#include "testCheck.hpp"
+#include "../commune/spaceSaving.hpp"
+
+#include <random>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+using namespace std;
+using namespace Whisper;
+
+
+// Below the capacity every key has its exact count
+static void test_exact()
+{
+    SpaceSaving<uint32_t> ss(16);
+    for (uint32_t k = 0; k < 10; k ++) {
+        ss.update(k, k + 1);
+        ss.update(k);
+    }
+    CHECK(ss.size() == 10);
+    const auto top = ss.top(16);
+    CHECK(top.size() == 10);
+    for (size_t i = 0; i < top.size(); i ++) {
+        CHECK(top[i].key == 9 - i);
+        CHECK(top[i].count == 11 - i && top[i].error == 0);
+    }
+}
+
+
+// The Space-Saving bounds on a skewed stream: for every monitored key,
+// count - error <= true count <= count and error <= N / capacity, the counts sum to N,
+// and every key heavier than N / capacity is monitored
+static void test_error_bound()
+{
+    const size_t capacity = 64, n_key = 5000, n = 200000;
+    SpaceSaving<uint32_t> ss(capacity);
+    unordered_map<uint32_t, uint64_t> truth;
+
+    // Zipf-like ranks, the heaviest keys spread over the key space
+    mt19937 rng(37);
+    vector<double_t> weight(n_key);
+    for (size_t i = 0; i < n_key; i ++) {
+        weight[i] = 1.0 / (i + 1);
+    }
+    discrete_distribution<uint32_t> rank(weight.begin(), weight.end());
+    for (size_t i = 0; i < n; i ++) {
+        const uint32_t key = rank(rng) * 2654435761u;
+        ss.update(key);
+        ++ truth[key];
+    }
+
+    CHECK(ss.size() == capacity);
+    const auto all = ss.top(capacity);
+    uint64_t sum = 0;
+    for (const auto & c : all) {
+        const uint64_t t = truth.count(c.key) ? truth[c.key] : 0;
+        CHECK(c.count - c.error <= t && t <= c.count);
+        CHECK(c.error <= n / capacity);
+        sum += c.count;
+    }
+    CHECK(sum == n);
+
+    for (const auto & kv : truth) {
+        if (kv.second > n / capacity) {
+            CHECK(any_of(all.begin(), all.end(), [&kv] (const SpaceSaving<uint32_t>::Counter & c) -> bool {
+                return c.key == kv.first;
+            }));
+        }
+    }
+
+    // descending guaranteed counts, led by the heaviest key
+    for (size_t i = 1; i < all.size(); i ++) {
+        CHECK(all[i - 1].count - all[i - 1].error >= all[i].count - all[i].error);
+    }
+    CHECK(all[0].key == 0);
+    CHECK(ss.top(5).size() == 5);
+}
+
+
+// A key over a full summary takes over the smallest counter, whose count becomes its error
+static void test_take_over()
+{
+    SpaceSaving<uint32_t> ss(2);
+    ss.update(1, 5);
+    ss.update(2, 3);
+    ss.update(3);
+    const auto top = ss.top(2);
+    CHECK(top.size() == 2);
+    CHECK(top[0].key == 1 && top[0].count == 5 && top[0].error == 0);
+    CHECK(top[1].key == 3 && top[1].count == 4 && top[1].error == 3);
+
+    // the old key comes back over the new one
+    ss.update(2);
+    const auto again = ss.top(2);
+    CHECK(again[1].key == 2 && again[1].count == 5 && again[1].error == 4);
+}
+
+
+// Decay halves counts and errors and keeps the summary usable
+static void test_decay()
+{
+    SpaceSaving<uint32_t> ss(4);
+    for (uint32_t k = 0; k < 4; k ++) {
+        ss.update(k, 10 * (k + 1));
+    }
+    ss.update(9, 1);
+    ss.decay();
+    auto top = ss.top(4);
+    CHECK(top.size() == 4);
+    CHECK(top[0].key == 3 && top[0].count == 20);
+    CHECK(top[3].key == 9 && top[3].count == 5 && top[3].error == 5);
+
+    // the recent stream now dominates
+    ss.update(7, 100);
+    top = ss.top(1);
+    CHECK(top[0].key == 7 && top[0].count == 105 && top[0].error == 5);
+}
+
+
+int main()
+{
+    test_exact();
+    test_error_bound();
+    test_take_over();
+    test_decay();
+    LOGF("SpaceSaving tests passed.");
+    return 0;
+}
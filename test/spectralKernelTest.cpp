@@ -0,0 +1,140 @@
+#include "testCheck.hpp"
+#include "../commune/spectralKernel.hpp"
+
+#include <random>
+#include <vector>
+#include <limits>
+
+using namespace std;
+using namespace Whisper;
+
+
+static mt19937 rng(11);
+
+
+// Equal up to float rounding, non-finite results are scrubbed to 0 by both kernels
+static auto close_to(double_t a, double_t b, double_t tol) -> bool
+{
+    return fabs(a - b) <= tol * max(1.0, fabs(b));
+}
+
+
+static void check_encode(const SpectralKernel * p_vec, const SpectralKernel * p_ref)
+{
+    uniform_int_distribution<int> len_dist(40, 1500), proto_dist(0, 1000);
+    uniform_real_distribution<double_t> gap_dist(-1e-4, 2.0);
+    vector<PacketMetaData> raw(2000);
+    double_t ts = 1.6e9;
+    for (auto & pkt : raw) {
+        // out of order and equal time stamps included, clamped by both kernels
+        ts += gap_dist(rng) * gap_dist(rng);
+        pkt = PacketMetaData(0, 0, proto_dist(rng), len_dist(rng), ts);
+    }
+    uniform_int_distribution<size_t> index_dist(0, raw.size() - 1);
+    for (const size_t n : {0, 1, 7, 8, 9, 16, 100, 1001}) {
+        vector<size_t> index(n);
+        for (auto & v : index) {
+            v = index_dist(rng);
+        }
+        for (const double_t prev_ts : {-1.0, 1.6e9}) {
+            vector<float> out_vec(n), out_ref(n);
+            p_vec->encode_packets(raw.data(), index.data(), n, prev_ts, out_vec.data());
+            p_ref->encode_packets(raw.data(), index.data(), n, prev_ts, out_ref.data());
+            for (size_t i = 0; i < n; i ++) {
+                CHECK(close_to(out_vec[i], out_ref[i], 3e-7));
+            }
+        }
+    }
+}
+
+
+static void check_power_log_scrub(const SpectralKernel * p_vec, const SpectralKernel * p_ref)
+{
+    uniform_real_distribution<float> val_dist(-1e3, 1e3);
+    uniform_int_distribution<int> special_dist(0, 50);
+    for (const size_t n_freq : {1, 5, 33}) {
+        for (const size_t n_frame : {1, 7, 8, 16, 17, 100}) {
+            vector<float> spec(n_freq * n_frame * 2);
+            for (auto & v : spec) {
+                switch (special_dist(rng)) {
+                    case 0: v = numeric_limits<float>::quiet_NaN(); break;
+                    case 1: v = numeric_limits<float>::infinity(); break;
+                    // the power overflows to Inf
+                    case 2: v = 1e30f; break;
+                    case 3: v = 0; break;
+                    default: v = val_dist(rng) * (special_dist(rng) < 25 ? 1e-3f : 1.0f);
+                }
+            }
+            vector<float> out_vec(n_freq * n_frame), out_ref(n_freq * n_frame);
+            p_vec->power_log_scrub(spec.data(), n_freq, n_frame, out_vec.data());
+            p_ref->power_log_scrub(spec.data(), n_freq, n_frame, out_ref.data());
+            for (size_t i = 0; i < out_ref.size(); i ++) {
+                CHECK(isfinite(out_vec[i]));
+                CHECK(close_to(out_vec[i], out_ref[i], 1e-6));
+            }
+        }
+    }
+}
+
+
+static void check_center_dist(const SpectralKernel * p_vec, const SpectralKernel * p_ref)
+{
+    uniform_real_distribution<float> val_dist(0, 20);
+    for (const size_t n_dim : {1, 3, 4, 65}) {
+        for (const size_t n_center : {1, 3, 4, 9}) {
+            const size_t n_win = 6;
+            vector<float> win(n_win * n_dim), center(n_center * n_dim);
+            for (auto & v : win) {
+                v = val_dist(rng);
+            }
+            for (auto & v : center) {
+                v = val_dist(rng);
+            }
+            // the inputs as center_distance builds them
+            vector<float> dot(n_win * n_center), center_norm(n_center);
+            for (size_t j = 0; j < n_center; j ++) {
+                for (size_t k = 0; k < n_dim; k ++) {
+                    center_norm[j] += center[j * n_dim + k] * center[j * n_dim + k];
+                }
+                for (size_t i = 0; i < n_win; i ++) {
+                    for (size_t k = 0; k < n_dim; k ++) {
+                        dot[i * n_center + j] += win[i * n_dim + k] * center[j * n_dim + k];
+                    }
+                }
+            }
+            for (const double_t alert_bound : {0.0, 5.0}) {
+                const double_t d_vec = p_vec->max_min_center_dist(win.data(), dot.data(), center_norm.data(), 
+                                                                  n_win, n_dim, n_center, alert_bound);
+                const double_t d_ref = p_ref->max_min_center_dist(win.data(), dot.data(), center_norm.data(), 
+                                                                  n_win, n_dim, n_center, alert_bound);
+                CHECK(close_to(d_vec, d_ref, 1e-6));
+            }
+        }
+    }
+}
+
+
+int main()
+{
+    const auto p_scalar = select_spectral_kernel("scalar");
+    CHECK(string(p_scalar->isa_name) == "scalar");
+
+    // every vector kernel set supported by this CPU against the scalar one
+    size_t n_checked = 0;
+    for (const auto & isa : spectral_kernel_isa_list) {
+        const auto p_kernel = select_spectral_kernel(isa);
+        if (isa == "auto" || string(p_kernel->isa_name) != isa || p_kernel == p_scalar) {
+            continue;
+        }
+        check_encode(p_kernel, p_scalar);
+        check_power_log_scrub(p_kernel, p_scalar);
+        check_center_dist(p_kernel, p_scalar);
+        LOGF("Kernel %s matches the scalar kernel.", p_kernel->isa_name);
+        ++ n_checked;
+    }
+    if (n_checked == 0) {
+        LOGF("No vector kernel supported by this CPU, nothing compared.");
+    }
+    LOGF("SpectralKernel tests passed.");
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include "testCheck.hpp"
+#include "../commune/spscRing.hpp"
+
+#include <vector>
+#include <thread>
+
+using namespace std;
+using namespace Whisper;
+
+
+static void test_capacity()
+{
+    CHECK(SpscRing<int>(1).capacity() == 1);
+    CHECK(SpscRing<int>(5).capacity() == 8);
+    CHECK(SpscRing<int>(8).capacity() == 8);
+    CHECK(SpscRing<int>(1000).capacity() == 1024);
+}
+
+
+static void test_full_and_empty()
+{
+    SpscRing<int> ring(4);
+    int v = -1;
+    CHECK(!ring.pop(v));
+    CHECK(v == -1);
+    CHECK(ring.size() == 0);
+
+    for (int i = 0; i < 4; i ++) {
+        CHECK(ring.push(int(i)));
+    }
+    CHECK(!ring.push(4));
+    CHECK(ring.size() == 4);
+    CHECK(ring.max_size() == 4);
+
+    for (int i = 0; i < 4; i ++) {
+        CHECK(ring.pop(v));
+        CHECK(v == i);
+    }
+    CHECK(!ring.pop(v));
+    CHECK(ring.size() == 0);
+    // the high-water depth is kept
+    CHECK(ring.max_size() == 4);
+}
+
+
+static void test_wrap()
+{
+    // the positions run far past the capacity, the order is kept across the wrap
+    SpscRing<size_t> ring(3);
+    size_t next_push = 0, next_pop = 0;
+    for (size_t round = 0; round < 1000; round ++) {
+        const size_t n_push = round % 5;
+        for (size_t i = 0; i < n_push; i ++) {
+            if (ring.push(size_t(next_push))) {
+                ++ next_push;
+            } else {
+                CHECK(ring.size() == ring.capacity());
+            }
+        }
+        const size_t n_pop = (round * 7) % 4;
+        size_t v;
+        for (size_t i = 0; i < n_pop && ring.pop(v); i ++) {
+            CHECK(v == next_pop);
+            ++ next_pop;
+        }
+        CHECK(ring.size() == next_push - next_pop);
+    }
+    CHECK(ring.max_size() == ring.capacity());
+}
+
+
+static void test_move_only()
+{
+    SpscRing<unique_ptr<int> > ring(2);
+    CHECK(ring.push(unique_ptr<int>(new int(3))));
+    unique_ptr<int> p;
+    CHECK(ring.pop(p));
+    CHECK(p != nullptr && *p == 3);
+}
+
+
+static void test_two_threads()
+{
+    const size_t n = 1000000;
+    SpscRing<size_t> ring(64);
+    thread producer([&] () {
+        for (size_t i = 0; i < n; i ++) {
+            while (!ring.push(size_t(i))) {
+                this_thread::yield();
+            }
+        }
+    });
+    size_t expect = 0, v;
+    while (expect < n) {
+        if (ring.pop(v)) {
+            CHECK(v == expect);
+            ++ expect;
+        } else {
+            this_thread::yield();
+        }
+    }
+    producer.join();
+    CHECK(!ring.pop(v));
+    CHECK(ring.max_size() <= ring.capacity());
+}
+
+
+int main()
+{
+    test_capacity();
+    test_full_and_empty();
+    test_wrap();
+    test_move_only();
+    test_two_threads();
+    LOGF("SpscRing tests passed.");
+    return 0;
+}
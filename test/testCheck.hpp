@@ -0,0 +1,12 @@
+#pragma once
+
+#include "../common.hpp"
+
+
+// Check of a unit test, kept in release builds unlike assert
+#define CHECK(cond) \
+    do {\
+        if (!(cond)) {\
+            FATAL_ERROR("Check failed: " CODE_2_STR(cond));\
+        }\
+    } while(0)
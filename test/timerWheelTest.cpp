@@ -0,0 +1,126 @@
+#include "testCheck.hpp"
+#include "../commune/timerWheel.hpp"
+
+#include <random>
+#include <vector>
+#include <map>
+
+using namespace std;
+using namespace Whisper;
+
+using wheel_t = HierarchicalTimerWheel<uint64_t>;
+
+// Ticks covered by the wheel before an entry is clamped to its last slot
+static const uint64_t wheel_range = (uint64_t) 1 << (TIMER_WHEEL_BIT * TIMER_WHEEL_LEVEL);
+
+
+static void test_cascade_by_tick()
+{
+    // entries around the slot boundaries of every level, and beyond the range of the wheel
+    vector<uint64_t> ticks = {1, 2};
+    for (size_t level = 1; level <= TIMER_WHEEL_LEVEL; level ++) {
+        const uint64_t span = (uint64_t) 1 << (TIMER_WHEEL_BIT * level);
+        for (const uint64_t t : {span - 1, span, span + 1, 3 * span + 5}) {
+            ticks.push_back(t);
+        }
+    }
+    ticks.push_back(wheel_range + 100);
+
+    wheel_t wheel;
+    for (const auto t : ticks) {
+        wheel.schedule(t, t);
+    }
+    CHECK(wheel.size() == ticks.size());
+
+    // every entry fires exactly at its tick: not on the tick before, and on its own
+    map<uint64_t, uint64_t> fired;
+    sort(ticks.begin(), ticks.end());
+    for (const auto now : ticks) {
+        wheel.advance(now - 1, [] (uint64_t, uint64_t) {
+            CHECK(false);
+        });
+        wheel.advance(now, [&] (uint64_t key, uint64_t tick) {
+            CHECK(key == now && tick == now);
+            ++ fired[key];
+        });
+    }
+    CHECK(fired.size() == ticks.size());
+    for (const auto & ref : fired) {
+        CHECK(ref.second == 1);
+    }
+    CHECK(wheel.size() == 0);
+}
+
+
+static void test_random_advance()
+{
+    // the entries fire in the advance that passes their tick, in any order of scheduling
+    mt19937_64 rng(5);
+    uniform_int_distribution<uint64_t> delta_dist(1, 300000), step_dist(0, 20000);
+    wheel_t wheel;
+    map<uint64_t, uint64_t> pending;
+    uint64_t now = 1000, key = 0;
+    wheel.advance(now, [] (uint64_t, uint64_t) {});
+    for (size_t round = 0; round < 2000; round ++) {
+        for (size_t i = 0; i < 5; i ++) {
+            const uint64_t t = now + delta_dist(rng);
+            wheel.schedule(key, t);
+            pending[key ++] = t;
+        }
+        const uint64_t prev = now;
+        now += step_dist(rng);
+        wheel.advance(now, [&] (uint64_t k, uint64_t tick) {
+            CHECK(pending.count(k) == 1);
+            CHECK(pending[k] == tick);
+            CHECK(tick > prev && tick <= now);
+            pending.erase(k);
+        });
+        for (const auto & ref : pending) {
+            CHECK(ref.second > now);
+        }
+        CHECK(wheel.size() == pending.size());
+    }
+}
+
+
+static void test_jump_and_passed_tick()
+{
+    // an empty wheel jumps to the time of the owner, e.g. from 0 to a time stamp in ms
+    wheel_t wheel;
+    const uint64_t t0 = 1600000000000ull;
+    wheel.advance(t0 - 100, [] (uint64_t, uint64_t) {});
+    // the later epoch end first, as the flows of a batch crossing an epoch
+    wheel.schedule(1, t0);
+    wheel.schedule(3, t0 - 50);
+    wheel.advance(t0 - 50, [&] (uint64_t key, uint64_t tick) {
+        CHECK(key == 3 && tick == t0 - 50);
+    });
+    CHECK(wheel.size() == 1);
+    size_t n_fire = 0;
+    wheel.advance(t0, [&] (uint64_t key, uint64_t tick) {
+        CHECK(key == 1 && tick == t0);
+        ++ n_fire;
+    });
+    CHECK(n_fire == 1);
+
+    // a tick already passed fires on the next advance
+    wheel.schedule(2, t0 - 10);
+    wheel.advance(t0, [&] (uint64_t, uint64_t) { ++ n_fire; });
+    CHECK(n_fire == 1);
+    wheel.advance(t0 + 1, [&] (uint64_t key, uint64_t) {
+        CHECK(key == 2);
+        ++ n_fire;
+    });
+    CHECK(n_fire == 2);
+    CHECK(wheel.size() == 0);
+}
+
+
+int main()
+{
+    test_cascade_by_tick();
+    test_random_advance();
+    test_jump_and_passed_tick();
+    LOGF("TimerWheel tests passed.");
+    return 0;
+}
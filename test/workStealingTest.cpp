@@ -0,0 +1,100 @@
+#include "testCheck.hpp"
+#include "../commune/workStealing.hpp"
+
+#include <vector>
+#include <atomic>
+#include <thread>
+
+using namespace std;
+using namespace Whisper;
+
+
+static void test_empty()
+{
+    WorkStealingDeque<int> deque;
+    int v = -1;
+    CHECK(!deque.pop(v));
+    CHECK(!deque.steal(v));
+    CHECK(v == -1);
+    CHECK(deque.size() == 0);
+}
+
+
+static void test_order()
+{
+    // the owner takes the newest task, a thief the oldest
+    WorkStealingDeque<int> deque;
+    for (int i = 1; i <= 5; i ++) {
+        deque.push(i);
+    }
+    int v;
+    CHECK(deque.steal(v) && v == 1);
+    CHECK(deque.pop(v) && v == 5);
+    CHECK(deque.steal(v) && v == 2);
+    CHECK(deque.pop(v) && v == 4);
+    CHECK(deque.size() == 1);
+
+    // the last task goes to either side once
+    CHECK(deque.steal(v) && v == 3);
+    CHECK(!deque.pop(v));
+    CHECK(!deque.steal(v));
+
+    // reusable once drained
+    deque.push(6);
+    CHECK(deque.pop(v) && v == 6);
+    CHECK(deque.size() == 0);
+}
+
+
+static void test_concurrent_steal()
+{
+    // every task is taken exactly once by the owner or one of the thieves
+    const size_t n = 200000, n_thief = 3;
+    WorkStealingDeque<size_t> deque;
+    vector<atomic<int> > taken(n);
+    for (auto & t : taken) {
+        t.store(0);
+    }
+    atomic<bool> is_done{false};
+
+    vector<thread> thieves;
+    for (size_t i = 0; i < n_thief; i ++) {
+        thieves.emplace_back([&] () {
+            size_t v;
+            while (!is_done.load(memory_order_acquire) || deque.size() != 0) {
+                if (deque.steal(v)) {
+                    taken[v].fetch_add(1);
+                } else {
+                    this_thread::yield();
+                }
+            }
+        });
+    }
+    size_t v;
+    for (size_t i = 0; i < n; i ++) {
+        deque.push(i);
+        if (i % 3 == 0 && deque.pop(v)) {
+            taken[v].fetch_add(1);
+        }
+    }
+    while (deque.pop(v)) {
+        taken[v].fetch_add(1);
+    }
+    is_done.store(true, memory_order_release);
+    for (auto & t : thieves) {
+        t.join();
+    }
+    for (const auto & t : taken) {
+        CHECK(t.load() == 1);
+    }
+}
+
+
+int main()
+{
+    test_empty();
+    test_order();
+    test_concurrent_steal();
+    LOGF("WorkStealingDeque tests passed.");
+    return 0;
+}